@@ -0,0 +1,99 @@
+#pragma once
+
+#include <ebus/ebus.hh>
+
+#include "task_scheduler.hh"
+#include "memory/mpmc_queue.hh"
+
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <string_view>
+
+namespace EBUS_NS
+{
+
+/**
+ * @class affinity_queue_iface
+ *
+ * The ONE2ONE bus of the affinity queues, keyed by @ref affinity_tag. Tasks
+ * usually go through task_scheduler_iface::add_task(affinity_tag, task).
+ */
+struct affinity_queue_iface : public ebus_iface<ebus_type::ONE2ONE>
+{
+    virtual bool m_add_task(task_base::ptr task) = 0;
+};
+
+using affinity_queue_bus = ebus<affinity_queue_iface>;
+
+/**
+ * @class affinity_queue
+ *
+ * A named queue of tasks that only run on the thread pumping it, like the
+ * main loop or a subsystem that is not thread safe. Any thread, workers
+ * included, adds tasks with an @ref affinity_tag; the owning thread runs them
+ * with run_pending(), bounded by a number of tasks or a time budget.
+ *
+ * Adding a task is a lookup on the bus and a push on a lock-free @ref
+ * mpmc_queue. Only when the ring is full do tasks spill to a locked
+ * overflow, which is drained after the ring.
+ *
+ * Usage Example:
+ * @code
+ * affinity_queue main_queue("main");
+ *
+ * task_scheduler_iface::add_task(make_task([]() {
+ *     auto result = compute();
+ *     // back on the main thread
+ *     task_scheduler_iface::add_task(affinity_tag_of("main"),
+ *                                    make_task([result]() { show(result); }));
+ * }));
+ *
+ * while (running)
+ * {
+ *     poll_events();
+ *     main_queue.run_pending(std::chrono::milliseconds(2));
+ *     render();
+ * }
+ * @endcode
+ *
+ * Tasks still queued when the queue goes away are dropped.
+ */
+class affinity_queue : public ebus_handler<affinity_queue_iface>
+{
+    using handler_t = ebus_handler<affinity_queue_iface>;
+
+public:
+    explicit affinity_queue(std::string_view name, size_t capacity = 1024);
+    ~affinity_queue();
+
+    affinity_queue(const affinity_queue&)            = delete;
+    affinity_queue& operator=(const affinity_queue&) = delete;
+
+    /// @brief false if another queue already has the name.
+    bool         connected() const { return m_connected; }
+    affinity_tag tag() const { return m_tag; }
+    size_t       size() const;
+
+    /// @brief runs up to max_tasks queued tasks on the calling thread,
+    /// returns how many ran. Tasks added meanwhile may run too.
+    size_t run_pending(size_t max_tasks = std::numeric_limits<size_t>::max());
+    /// @brief runs queued tasks until the budget is spent, at least one if
+    /// any is queued, returns how many ran.
+    size_t run_pending(task_clock::duration budget);
+
+    bool m_add_task(task_base::ptr task) override;
+
+private:
+    bool try_pop(task_base::ptr& task);
+
+    affinity_tag               m_tag;
+    bool                       m_connected = false;
+    mpmc_queue<task_base::ptr> m_tasks;
+    std::atomic_bool           m_spilled = false;
+    mutable std::mutex         m_overflow_lock;
+    std::deque<task_base::ptr> m_overflow;
+};
+
+} // namespace EBUS_NS
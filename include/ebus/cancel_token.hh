@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <ebus/memory/block_pool.hh>
+#include <ebus/memory/intrusive_ptr.hh>
+#include <ebus/memory/ref_counted.hh>
+
+namespace EBUS_NS
+{
+
+/**
+ * @class cancel_token
+ *
+ * A cooperative cancellation flag shared by every copy of the token. Give a
+ * copy to each task of a group and cancel() them all with a single store; a
+ * default constructed token is never cancelled and costs nothing.
+ *
+ * Workers skip a task whose token is cancelled before exec() (see
+ * task_base::run()), a long task polls cancelled(), a relaxed load.
+ *
+ * Usage Example:
+ * @code
+ * cancel_token request = cancel_token::make();
+ * for (auto& part : parts)
+ * {
+ *     task_base::ptr task = make_task([part, request]() {
+ *         for (auto& row : part)
+ *         {
+ *             if (request.cancelled())
+ *                 return;
+ *             process(row);
+ *         }
+ *     });
+ *     task->m_cancel = request;
+ *     task_scheduler_iface::add_task(task);
+ * }
+ * // the client went away
+ * request.cancel();
+ * @endcode
+ */
+class cancel_token
+{
+public:
+    cancel_token() = default;
+
+    /// @brief a token that can be cancelled.
+    static cancel_token make() { return cancel_token(new state); }
+
+    /// @brief cancels every copy of the token, does nothing on a default one.
+    void cancel() const
+    {
+        if (m_state)
+            m_state->m_cancelled.store(true, std::memory_order_release);
+    }
+
+    bool cancelled() const
+    {
+        return m_state && m_state->m_cancelled.load(std::memory_order_relaxed);
+    }
+
+    explicit operator bool() const { return (bool)m_state; }
+
+private:
+    struct state : ref_counted<state>
+    {
+        using pool = block_pool<16>;
+
+        std::atomic_bool m_cancelled = false;
+
+        static void* operator new(size_t) { return pool::allocate(); }
+        static void  operator delete(void* p) { pool::deallocate(p); }
+    };
+
+    explicit cancel_token(state* s) :
+        m_state(s)
+    {
+    }
+
+    INTRUSIVE_NS::intrusive_ptr<state> m_state;
+};
+
+} // namespace EBUS_NS
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace EBUS_NS
+{
+
+/// @brief FNV-1a of a string, constexpr so names hash at compile time, and
+/// the same in every process and build.
+constexpr uint64_t
+fnv1a(std::string_view text)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : text)
+    {
+        hash ^= (uint8_t)c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace EBUS_NS
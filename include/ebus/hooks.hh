@@ -2,14 +2,71 @@
 
 #include "constructor.hh"
 #include "singleton.hh"
+#include "task.hh"
 
-#include <vector>
+#include <atomic>
+#include <initializer_list>
+#include <iterator>
 #include <mutex>
+#include <string>
 #include <type_traits>
+#include <unordered_set>
+#include <vector>
 
 namespace EBUS_NS
 {
 
+/// a registered hook, with its name and the names of the hooks it runs
+/// after. Unnamed hooks cannot be depended on.
+struct hook_entry
+{
+    using hook_fn = void (*)();
+
+    hook_fn                  fn   = nullptr;
+    const char*              name = nullptr;
+    std::vector<const char*> after;
+};
+
+/// how long a hook took, unnamed hooks have an empty name.
+struct hook_timing
+{
+    std::string          name;
+    task_clock::duration took{0};
+    bool                 skipped = false; // in a dependency cycle, or after one
+    bool                 waiting = false; // after a hook not added yet
+};
+
+/**
+ * @struct hook_report
+ *
+ * What a run of the hooks took, hook by hook in registration order.
+ */
+struct hook_report
+{
+    std::vector<hook_timing> hooks;
+    task_clock::duration     took{0}; // the whole run
+    bool                     parallel = false;
+    bool                     cycle    = false; // some hooks were skipped
+    bool                     waiting  = false; // some hooks wait
+};
+
+/**
+ * @brief runs the hooks, each one after the hooks it names in
+ * hook_entry::after. A dependency named in ran, which ran before, is met. A
+ * dependency neither in hooks nor in ran is not: the hook and the ones
+ * depending on it are not run and reported waiting. The hooks of a
+ * dependency cycle and the ones depending on them are not run either, they
+ * are reported skipped. The others then run serially.
+ *
+ * With a task scheduler of more than one worker and parallel set, the hooks
+ * run as a @ref task_graph, independent hooks at the same time, and the call
+ * blocks until they are all done. Otherwise they run on the calling thread
+ * in registration order, each one delayed until its dependencies ran.
+ */
+hook_report run_hook_list(const std::vector<hook_entry>&         hooks,
+                          bool                                   parallel,
+                          const std::unordered_set<std::string>& ran = {});
+
 /**
  * @brief hook_registry
  *
@@ -28,8 +85,20 @@ namespace EBUS_NS
  * EBUS_HOOK_REGISTRY_FUNCTION(MyHookRegistry) {
  *     // Hook code executed during initialization
  * }
+ *
+ * // named hooks, "audio" only runs once "config" and "log" are done.
+ * EBUS_HOOK_REGISTRY_NAMED(MyHookRegistry, config) { load_config(); }
+ * EBUS_HOOK_REGISTRY_NAMED(MyHookRegistry, audio, "config", "log") {
+ *     init_audio();
+ * }
+ *
+ * hook_report report = MyHookRegistry::instance().run_hooks();
  * @endcode
  *
+ * The hooks run serially on the calling thread. run_hooks(true) runs them
+ * in parallel on the task scheduler, see run_hook_list(), for registries
+ * whose hooks are safe to run concurrently: a hook needing another one to
+ * run first has to name it.
  */
 template <class SUBCLASS>
 class hook_registry
@@ -38,40 +107,159 @@ public:
     using hook_t     = void (*)();
     using subclass_t = SUBCLASS;
 
+    /// see @ref lazy_hook_registry.
+    static constexpr bool lazy = false;
+
+    /// @brief the registry, a lazy one first runs its pending hooks.
     static SUBCLASS& instance()
     {
+        SUBCLASS& self = registry();
+        if constexpr (SUBCLASS::lazy)
+        {
+            // a single load once the hooks ran, a hook using the registry
+            // while it runs gets it as it is.
+            if (self.m_added.load(std::memory_order_acquire) && !t_running)
+            {
+                t_running = true;
+                self.run_hooks(false);
+                t_running = false;
+            }
+        }
+        return self;
+    }
 
+    /// @brief the registry without running anything, for adding hooks.
+    static SUBCLASS& registry()
+    {
         static_assert(std::is_base_of_v<hook_registry<SUBCLASS>, SUBCLASS>,
                       "invalid hook_registry");
-        return singleton<subclass_t>::get_instance();
+        return singleton_ref<subclass_t>::get();
     }
 
-    void add_hook(hook_t hook)
+    void add_hook(hook_t hook) { add_hook(hook, nullptr, {}); }
+
+    /// @brief a named hook, running after the hooks named in after.
+    void add_hook(hook_t                             hook,
+                  const char*                        name,
+                  std::initializer_list<const char*> after)
     {
         std::scoped_lock<std::mutex> lock(m_lock);
-        m_hooks.push_back(hook);
+        m_hooks.push_back({hook, name, after});
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        m_added.fetch_add(1, std::memory_order_relaxed);
     }
 
-    void run_hooks()
+    /// @brief runs the hooks added since the last run, the ones of a library
+    /// loaded meanwhile for instance. A dependency on a hook of an earlier
+    /// run is already met, one on a hook not added yet is not: the hook
+    /// waits for a later run, see run_hook_list(). The waiting and skipped
+    /// hooks are kept, still pending. Hooks added by the hooks themselves
+    /// wait for the next run, a concurrent run waits for this one.
+    hook_report run_hooks(bool parallel = false)
     {
+        std::scoped_lock<std::mutex> run_lock(m_run_lock);
+        std::vector<hook_entry>      hooks;
+        size_t                       added = 0;
+        {
+            std::scoped_lock<std::mutex> lock(m_lock);
+            hooks.swap(m_hooks);
+            added = m_added.load(std::memory_order_relaxed);
+        }
+        // only changed by a run, under the run lock.
+        hook_report report = run_hook_list(hooks, parallel, m_ran);
+
         std::scoped_lock<std::mutex> lock(m_lock);
-        for (const auto& hook : m_hooks)
+        std::vector<hook_entry>      kept;
+        size_t                       ran = 0;
+        for (size_t i = 0; i < hooks.size(); i++)
         {
-            hook();
+            if (report.hooks[i].skipped || report.hooks[i].waiting)
+            {
+                kept.push_back(std::move(hooks[i]));
+                continue;
+            }
+            if (hooks[i].name)
+                m_ran.insert(hooks[i].name);
+            m_ran_count++;
+            ran++;
         }
-        m_hooks.clear();
+        // before the hooks added meanwhile, in registration order.
+        m_hooks.insert(m_hooks.begin(),
+                       std::make_move_iterator(kept.begin()),
+                       std::make_move_iterator(kept.end()));
+        m_pending.fetch_sub(ran, std::memory_order_release);
+        // only now, a lazy instance() racing with the run waits for it.
+        m_added.fetch_sub(added, std::memory_order_release);
+        return report;
+    }
+
+    /// @brief hooks added and not run yet, the waiting and skipped ones
+    /// included.
+    size_t pending() const { return m_pending.load(std::memory_order_acquire); }
+
+    /// @brief hooks run so far.
+    size_t ran()
+    {
+        std::scoped_lock<std::mutex> lock(m_lock);
+        return m_ran_count;
+    }
+
+    /// @brief whether the hook with this name ran.
+    bool has_run(const std::string& name)
+    {
+        std::scoped_lock<std::mutex> lock(m_lock);
+        return m_ran.count(name) != 0;
     }
 
 private:
-    std::mutex          m_lock;
-    std::vector<hook_t> m_hooks;
+    std::mutex                      m_run_lock;
+    std::mutex                      m_lock;
+    std::vector<hook_entry>         m_hooks;
+    std::unordered_set<std::string> m_ran;
+    size_t                          m_ran_count = 0;
+    std::atomic<size_t>             m_pending   = 0;
+    std::atomic<size_t>             m_added     = 0; // since the last run
+
+    static inline thread_local bool t_running = false;
+};
+
+/**
+ * @class lazy_hook_registry
+ *
+ * A hook registry running its hooks on the first instance() access instead
+ * of an explicit run_hooks(), so a subsystem nobody uses costs nothing at
+ * startup. Hooks added later, by a library loaded meanwhile, run on the next
+ * access. The hooks run serially on the accessing thread, other threads
+ * accessing the registry meanwhile wait for them.
+ *
+ * Usage Example:
+ * @code
+ * struct codec_registry : public lazy_hook_registry<codec_registry>
+ * {
+ *     void add_codec(codec* c);
+ * };
+ *
+ * EBUS_HOOK_REGISTRY_FUNCTION(codec_registry, flac)
+ * {
+ *     codec_registry::instance().add_codec(new flac_codec);
+ * }
+ *
+ * // the codecs register here, at the first use.
+ * codec_registry::instance().find("flac");
+ * @endcode
+ */
+template <class SUBCLASS>
+class lazy_hook_registry : public hook_registry<SUBCLASS>
+{
+public:
+    static constexpr bool lazy = true;
 };
 
 #define EBUS_HOOK_REGISTRY_DEF(TOKEN, NAME)                   \
     static void EBUS_CONCAT(_hooks_registry_, NAME)(void*);   \
     EBUS_CONSTRUCTOR(EBUS_CONCAT(_hooks_registry_add_, NAME)) \
     {                                                         \
-        hook_registry<TOKEN>::instance().add_hook(            \
+        hook_registry<TOKEN>::registry().add_hook(            \
             (void (*)())EBUS_CONCAT(_hooks_registry_, NAME)); \
     }                                                         \
     static void EBUS_CONCAT(_hooks_registry_, NAME)(void*)
@@ -79,6 +267,20 @@ private:
 #define EBUS_HOOK_REGISTRY_FUNCTION(REG, TAG) \
     EBUS_HOOK_REGISTRY_DEF(REG, EBUS_CONCAT(TAG, __COUNTER__))
 
+/// a hook named TAG, running after the hooks named by the string literals
+/// following it.
+#define EBUS_HOOK_REGISTRY_NAMED_DEF(TOKEN, NAME, ID, ...)           \
+    static void EBUS_CONCAT(_hooks_registry_, ID)();                 \
+    EBUS_CONSTRUCTOR(EBUS_CONCAT(_hooks_registry_add_, ID))          \
+    {                                                                \
+        hook_registry<TOKEN>::registry().add_hook(                   \
+            EBUS_CONCAT(_hooks_registry_, ID), NAME, {__VA_ARGS__}); \
+    }                                                                \
+    static void EBUS_CONCAT(_hooks_registry_, ID)()
+
+#define EBUS_HOOK_REGISTRY_NAMED(REG, TAG, ...) \
+    EBUS_HOOK_REGISTRY_NAMED_DEF(REG, #TAG, EBUS_CONCAT(TAG, __COUNTER__), __VA_ARGS__)
+
 #define EBUS_HOOK_REGISTRY_DECLARE(EBUSAPI, IFACE) \
     EBUSAPI##_API_TEMPLATE_CLASS(singleton<hook_registry<IFACE>::subclass_t>)
 
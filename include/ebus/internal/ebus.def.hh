@@ -11,10 +11,13 @@
 #include "../singleton.hh"
 
 #include <cstddef>
+#include <span>
+#include <tuple>
 #include <type_traits>
 #include <typeinfo>
 #include <unordered_map>
 #include <mutex>
+#include <vector>
 
 // here we define a concept that type T need to has a function
 template <typename T, typename function_t, typename... args_t>
@@ -45,6 +48,92 @@ struct ebus_iface
 template <class iface, ebus_type iface_type = iface::type>
 concept EBUS_IFACE = requires { std::is_base_of_v<ebus_iface<iface_type>, iface>; };
 
+/// interfaces declared with EBUS_TAP, their dispatches are handed to the tap
+/// of their bus_marshal. Found by ADL, in the namespace of the interface.
+template <class interface>
+concept ebus_tapped = requires(interface* iface) { ebus_marshal_of(iface); };
+
+template <class interface>
+using ebus_marshal_t = typename decltype(ebus_marshal_of((interface*)nullptr))::type;
+
+/// what a handler returns to stop a broadcast_until() or multicast_until(),
+/// a bool true works too.
+enum class ebus_result : uint8_t
+{
+    pass,     // the next handlers are called
+    consumed, // the dispatch stops
+};
+
+template <class result_t>
+constexpr bool
+ebus_consumed(const result_t& result)
+{
+    static_assert(std::is_same_v<result_t, ebus_result> ||
+                      std::is_same_v<result_t, bool>,
+                  "the handlers return an ebus_result or a bool");
+    if constexpr (std::is_same_v<result_t, ebus_result>)
+        return result == ebus_result::consumed;
+    else
+        return result;
+}
+
+/// the arguments of a bus method, as stored, and its result.
+template <class T>
+struct ebus_method_traits;
+
+template <class C, class R, class... A>
+struct ebus_method_traits<R (C::*)(A...)>
+{
+    using args_t   = std::tuple<std::decay_t<A>...>;
+    using result_t = R;
+};
+
+template <class C, class R, class... A>
+struct ebus_method_traits<R (C::*)(A...) noexcept> : ebus_method_traits<R (C::*)(A...)>
+{
+};
+
+/// the calls of a method queued with ebus::queue_batch(), and its tag.
+template <auto method>
+struct ebus_batch_of
+{
+    using args_t  = typename ebus_method_traits<decltype(method)>::args_t;
+    using calls_t = std::span<const args_t>;
+};
+
+/**
+ * @class ebus_batch_handler
+ *
+ * The batch form of a bus method, for a handler also deriving from its
+ * ebus_handler. flush_batch() calls on_batch() once with every call queued,
+ * the handlers without the batch form have the method called for each.
+ *
+ * Usage Example:
+ * @code
+ * struct particles : public ebus_handler<physics_iface>,
+ *                    public ebus_batch_handler<&physics_iface::impulse>
+ * {
+ *     void impulse(uint32_t body, vec3 force) override;
+ *     void on_batch(ebus_batch_of<&physics_iface::impulse>,
+ *                   ebus_batch_of<&physics_iface::impulse>::calls_t calls) override;
+ * };
+ *
+ * for (const contact& c : contacts)
+ *     physics_bus::queue_batch<&physics_iface::impulse>(c.body, c.force);
+ * physics_bus::flush_batch<&physics_iface::impulse>();
+ * @endcode
+ */
+template <auto method>
+class ebus_batch_handler
+{
+public:
+    virtual ~ebus_batch_handler() = default;
+
+    /// @brief receives the queued calls of method, in the queued order.
+    virtual void on_batch(ebus_batch_of<method>,
+                          typename ebus_batch_of<method>::calls_t calls) = 0;
+};
+
 /**
  * ebus the event bus interface
  *
@@ -75,6 +164,16 @@ public:
     template <typename function_t, typename... args_t>
     static void broadcast(function_t&& func, args_t&&... args);
 
+    /// @brief calls the handlers in priority order until one consumes the
+    /// call, returns that handler or nullptr.
+    template <typename function_t, typename... args_t>
+        requires(interface::type == ebus_type::GLOBAL)
+    static handler_t* broadcast_until(function_t&& func, args_t&&... args);
+
+    template <typename function_t, typename... args_t>
+        requires(interface::type == ebus_type::GROUP)
+    static handler_t* multicast_until(size_t id, function_t&& func, args_t&&... args);
+
     // invoke non-ided handler function
     template <typename result_t, typename function_t, typename... args_t>
         requires(interface::type == ebus_type::GLOBAL)
@@ -90,8 +189,58 @@ public:
         requires(interface::type == ebus_type::GROUP)
     static void invoke(result_t& result, size_t id, function_t&& func, args_t&&... args);
 
+    /// @brief queues a call of method on the calling thread, dispatched with
+    /// the others at flush_batch().
+    template <auto method, typename... args_t>
+        requires(interface::type == ebus_type::GLOBAL)
+    static void queue_batch(args_t&&... args);
+
+    /// @brief queues a call of method for the handlers of id.
+    template <auto method, typename... args_t>
+        requires(interface::type != ebus_type::GLOBAL)
+    static void queue_batch(size_t id, args_t&&... args);
+
+    /// @brief dispatches the calls of method queued on the calling thread,
+    /// one call per handler and id. Returns the number of calls.
+    template <auto method>
+    static size_t flush_batch();
+
+    /// @brief creates the bus context now instead of on first use, so no
+    /// dispatch pays for it.
+    static void init();
+
 private:
     handler_t& find_first_handler();
+
+    // the calls of a method queued by a thread, by id. A flush drops the
+    // ids nothing was queued for since the previous one.
+    template <auto method>
+    struct batch_queue
+    {
+        using args_t    = typename ebus_batch_of<method>::args_t;
+        using buckets_t = std::unordered_map<size_t, std::vector<args_t>>;
+
+        static batch_queue& local()
+        {
+            thread_local batch_queue queue;
+            return queue;
+        }
+
+        std::vector<args_t>& calls(size_t id);
+
+        buckets_t            m_buckets;
+        std::vector<args_t>* m_last    = nullptr; // the bucket queued into last
+        size_t               m_last_id = 0;
+        size_t               m_size    = 0;
+    };
+
+    // calls fn on the handlers a dispatch to id reaches, until one returns
+    // true, returns that one or nullptr.
+    template <typename fn_t>
+    static handler_t* for_each_handler(size_t id, fn_t&& fn);
+
+    template <typename function_t, typename... args_t>
+    static handler_t* dispatch_until(size_t id, function_t&& func, args_t&&... args);
 };
 
 struct ebus_priority_t
@@ -141,21 +290,25 @@ private:
     ssize_t                           m_id       = -1;
     float                             m_priority = 0.0f;
 
+    static constexpr size_t cache_line = 64;
+
     /**
-     * the context to hold all the handlers.
+     * the context to hold all the handlers. The lock has a cache line of its
+     * own, taking it does not invalidate the handler containers read by
+     * dispatches on other threads.
      */
-    struct ctx
+    struct alignas(cache_line) ctx
     {
         INTRUSIVE_NS::intrusive_list               m_handlers;
         std::unordered_map<size_t, ebus_handler*>  m_id_handlers;
         std::unordered_map<size_t, INTRUSIVE_NS::intrusive_list> m_group_handlers;
         using group_itr = std::unordered_map<size_t, INTRUSIVE_NS::intrusive_list>::iterator;
 
-        std::mutex m_lock;
+        alignas(cache_line) std::mutex m_lock;
     };
     friend class singleton<ctx>;
 
-    static ctx& get_context() { return singleton<ctx>::get_instance(); }
+    static ctx& get_context() { return singleton_ref<ctx>::get(); }
     static void insert_handler_at(intrusive_list&, ebus_handler&, const float);
 
     // hash_id only available for one_to_one ebus_types
@@ -123,6 +123,8 @@ ebus<interface>::event(size_t id, function_t&& func, args_t&&... args)
 {
     static_assert(interface::type == ebus_type::ONE2ONE,
                   "event(id) is reserved only for id based ebus");
+    if constexpr (ebus_tapped<interface>)
+        ebus_marshal_t<interface>::tap(id, func, args...);
 
     typename handler_t::ctx& ctx = handler_t::get_context();
     if (ctx.m_id_handlers.find(id) != ctx.m_id_handlers.end())
@@ -143,6 +145,9 @@ ebus<interface>::multicast(size_t id, function_t&& func, args_t&&... args)
 {
     static_assert(interface::type == ebus_type::GROUP,
                   "multicast(id) is reserved only for group type ebus");
+    if constexpr (ebus_tapped<interface>)
+        ebus_marshal_t<interface>::tap(id, func, args...);
+
     typename handler_t::ctx&           ctx = handler_t::get_context();
     typename handler_t::ctx::group_itr itr = ctx.m_group_handlers.find(id);
     // find the group
@@ -171,6 +176,8 @@ ebus<interface>::broadcast(function_t&& func, args_t&&... args)
 {
     static_assert(interface::type == ebus_type::GLOBAL,
                   "broadcast() is reserved only for global type ebus");
+    if constexpr (ebus_tapped<interface>)
+        ebus_marshal_t<interface>::tap(0, func, args...);
 
     typename handler_t::ctx&           ctx = handler_t::get_context();
     intrusive_list_iterable<handler_t> iterable(ctx.m_handlers, &handler_t::m_node);
@@ -268,4 +275,172 @@ ebus<interface>::invoke(result_t& result, size_t id, function_t&& func, args_t&&
     }
 }
 
+template <EBUS_IFACE interface>
+template <auto method>
+std::vector<typename ebus<interface>::template batch_queue<method>::args_t>&
+ebus<interface>::batch_queue<method>::calls(size_t id)
+{
+    // mostly the same id in a row.
+    if (m_last != nullptr && m_last_id == id)
+        return *m_last;
+    m_last    = &m_buckets[id];
+    m_last_id = id;
+    return *m_last;
+}
+
+template <EBUS_IFACE interface>
+template <auto method, typename... args_t>
+    requires(interface::type == ebus_type::GLOBAL)
+void
+ebus<interface>::queue_batch(args_t&&... args)
+{
+    if constexpr (ebus_tapped<interface>)
+        ebus_marshal_t<interface>::tap(0, method, args...);
+
+    batch_queue<method>& queue = batch_queue<method>::local();
+    queue.calls(0).emplace_back(std::forward<args_t>(args)...);
+    queue.m_size++;
+}
+
+template <EBUS_IFACE interface>
+template <auto method, typename... args_t>
+    requires(interface::type != ebus_type::GLOBAL)
+void
+ebus<interface>::queue_batch(size_t id, args_t&&... args)
+{
+    if constexpr (ebus_tapped<interface>)
+        ebus_marshal_t<interface>::tap(id, method, args...);
+
+    batch_queue<method>& queue = batch_queue<method>::local();
+    queue.calls(id).emplace_back(std::forward<args_t>(args)...);
+    queue.m_size++;
+}
+
+template <EBUS_IFACE interface>
+template <auto method>
+size_t
+ebus<interface>::flush_batch()
+{
+    using receiver_t = ebus_batch_handler<method>;
+    using calls_t    = typename ebus_batch_of<method>::calls_t;
+
+    batch_queue<method>& queue = batch_queue<method>::local();
+    size_t               size  = queue.m_size;
+    if (size == 0)
+        return 0;
+
+    // handlers may queue calls for the next flush while this one runs.
+    typename batch_queue<method>::buckets_t buckets;
+    buckets.swap(queue.m_buckets);
+    queue.m_last = nullptr;
+    queue.m_size = 0;
+
+    for (auto bucket = buckets.begin(); bucket != buckets.end();)
+    {
+        // an id of a previous flush only, dropped.
+        if (bucket->second.empty())
+        {
+            bucket = buckets.erase(bucket);
+            continue;
+        }
+        calls_t calls(bucket->second);
+        auto    deliver = [&calls](handler_t& handler)
+        {
+            if (receiver_t* receiver = dynamic_cast<receiver_t*>(&handler))
+            {
+                receiver->on_batch({}, calls);
+                return false;
+            }
+            auto scalar = [&handler](const auto&... a) { (handler.*method)(a...); };
+            for (const auto& call : calls)
+            {
+                std::apply(scalar, call);
+            }
+            return false;
+        };
+        for_each_handler(bucket->first, deliver);
+        bucket->second.clear();
+        ++bucket;
+    }
+
+    // keep the capacities, unless calls were queued meanwhile.
+    if (queue.m_buckets.empty())
+        queue.m_buckets.swap(buckets);
+    return size;
+}
+
+template <EBUS_IFACE interface>
+template <typename fn_t>
+typename ebus<interface>::handler_t*
+ebus<interface>::for_each_handler(size_t id, fn_t&& fn)
+{
+    typename handler_t::ctx& ctx = handler_t::get_context();
+    if constexpr (interface::type == ebus_type::ONE2ONE)
+    {
+        auto found = ctx.m_id_handlers.find(id);
+        if (found != ctx.m_id_handlers.end() && fn(*found->second))
+            return found->second;
+    }
+    else
+    {
+        intrusive_list* head = &ctx.m_handlers;
+        if constexpr (interface::type == ebus_type::GROUP)
+        {
+            typename handler_t::ctx::group_itr itr = ctx.m_group_handlers.find(id);
+            if (itr == ctx.m_group_handlers.end())
+                return nullptr;
+            head = &itr->second;
+        }
+        intrusive_list_iterable<handler_t> iterable(*head, &handler_t::m_node);
+        for (intrusive_list_iterator<handler_t> pos = iterable.begin(), tmp = pos.next();
+             pos != iterable.end();
+             pos = tmp, tmp = tmp.next())
+        {
+            handler_t& handler = *pos;
+            if (fn(handler))
+                return &handler;
+        }
+    }
+    return nullptr;
+}
+
+template <EBUS_IFACE interface>
+template <typename function_t, typename... args_t>
+typename ebus<interface>::handler_t*
+ebus<interface>::dispatch_until(size_t id, function_t&& func, args_t&&... args)
+{
+    if constexpr (ebus_tapped<interface>)
+        ebus_marshal_t<interface>::tap_until(id, func, args...);
+
+    // the handlers are sorted by priority, the first ones get to consume it.
+    auto consumed = [&](handler_t& handler)
+    { return ebus_consumed(std::invoke(func, &handler, args...)); };
+    return for_each_handler(id, consumed);
+}
+
+template <EBUS_IFACE interface>
+template <typename function_t, typename... args_t>
+    requires(interface::type == ebus_type::GLOBAL)
+typename ebus<interface>::handler_t*
+ebus<interface>::broadcast_until(function_t&& func, args_t&&... args)
+{
+    return dispatch_until(0, func, args...);
+}
+
+template <EBUS_IFACE interface>
+template <typename function_t, typename... args_t>
+    requires(interface::type == ebus_type::GROUP)
+typename ebus<interface>::handler_t*
+ebus<interface>::multicast_until(size_t id, function_t&& func, args_t&&... args)
+{
+    return dispatch_until(id, func, args...);
+}
+
+template <EBUS_IFACE interface>
+void
+ebus<interface>::init()
+{
+    singleton_ref<typename handler_t::ctx>::init();
+}
+
 } // namespace EBUS_NS
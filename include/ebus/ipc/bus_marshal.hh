@@ -0,0 +1,384 @@
+#pragma once
+
+#include <ebus/ebus.hh>
+
+#include "../hash.hh"
+
+#include <array>
+#include <atomic>
+#include <assert.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+namespace EBUS_NS
+{
+
+/**
+ * @struct bus_record
+ *
+ * A call on a bus, marshalled by a @ref bus_marshal into a fixed size record
+ * so records sit in plain arrays of shared or mapped memory. Only holds
+ * trivially copyable arguments, copied byte for byte.
+ */
+struct bus_record
+{
+    static constexpr size_t   size     = 128;
+    static constexpr size_t   capacity = size - 32; // bytes of arguments
+    static constexpr uint16_t until    = 1; // broadcast_until() or multicast_until()
+
+    uint64_t  iface  = 0; // see bus_marshal::iface_id()
+    uint64_t  id     = 0; // the handler id of an ONE2ONE or GROUP bus
+    uint64_t  time   = 0; // task_clock nanoseconds, set by whoever records it
+    uint16_t  method = 0; // index in the methods of the bus_marshal
+    uint16_t  flags  = 0; // until
+    uint32_t  length = 0; // bytes of arguments
+    std::byte args[capacity];
+};
+
+static_assert(sizeof(bus_record) == bus_record::size);
+static_assert(std::is_trivially_copyable_v<bus_record>);
+
+/// receives the records of the tapped dispatches.
+using bus_sink_fn = void (*)(const bus_record& record);
+
+/**
+ * @struct bus_tap
+ *
+ * The sink of the interfaces declared with @ref EBUS_TAP: while one is set,
+ * every broadcast(), event(id) and multicast(id) of their listed methods is
+ * marshalled and handed to it before being dispatched, broadcast_until() and
+ * multicast_until() flagged bus_record::until. Without a sink a dispatch
+ * costs a single load more.
+ */
+struct bus_tap
+{
+    static bus_sink_fn sink() { return s_sink.load(std::memory_order_acquire); }
+    /// @brief returns the previous sink, nullptr removes it.
+    static bus_sink_fn set_sink(bus_sink_fn sink)
+    {
+        return s_sink.exchange(sink, std::memory_order_acq_rel);
+    }
+
+private:
+    static inline constinit std::atomic<bus_sink_fn> s_sink = nullptr;
+};
+
+namespace marshal_detail
+{
+
+// the arguments of a method, as laid out in bus_record::args.
+template <class method_t>
+using layout_of = typename ebus_method_traits<method_t>::args_t;
+
+// where each argument sits in bus_record::args, every one aligned.
+template <class tuple_t>
+struct arg_layout;
+
+template <class... A>
+struct arg_layout<std::tuple<A...>>
+{
+    static constexpr std::array<size_t, sizeof...(A)> offsets = []()
+    {
+        std::array<size_t, sizeof...(A)> result{};
+        size_t                           at = 0, i = 0;
+        ((at = (at + alignof(A) - 1) / alignof(A) * alignof(A), result[i++] = at,
+          at += sizeof(A)),
+         ...);
+        return result;
+    }();
+
+    static constexpr size_t length = []()
+    {
+        size_t at = 0;
+        ((at = (at + alignof(A) - 1) / alignof(A) * alignof(A) + sizeof(A)), ...);
+        return at;
+    }();
+
+    static_assert((std::is_trivially_copyable_v<A> && ...),
+                  "only trivially copyable arguments can be marshalled");
+    static_assert(((alignof(A) <= alignof(std::max_align_t)) && ...),
+                  "over aligned arguments cannot be marshalled");
+    static_assert(length <= bus_record::capacity,
+                  "the arguments do not fit in a bus_record");
+};
+
+template <class layout_t, size_t... I, class... args_t>
+void
+write_args(bus_record& record, std::index_sequence<I...>, args_t&&... args)
+{
+    using args_layout = arg_layout<layout_t>;
+    static_assert(sizeof...(args_t) == std::tuple_size_v<layout_t>,
+                  "wrong number of arguments");
+
+    record.length = (uint32_t)args_layout::length;
+    (
+        [&]()
+        {
+            std::tuple_element_t<I, layout_t> value(std::forward<args_t>(args));
+            std::byte* at = record.args + args_layout::offsets[I];
+            std::memcpy(at, &value, sizeof(value));
+        }(),
+        ...);
+}
+
+/// the arguments of a record converted to layout_t, written in it.
+template <class layout_t, class... args_t>
+void
+write_args(bus_record& record, args_t&&... args)
+{
+    write_args<layout_t>(record, std::make_index_sequence<sizeof...(args_t)>(),
+                         std::forward<args_t>(args)...);
+}
+
+template <class layout_t, class fn_t, size_t... I>
+void
+read_args(const bus_record& record, fn_t&& fn, std::index_sequence<I...>)
+{
+    using args_layout = arg_layout<layout_t>;
+
+    // copied out first, the record may not be aligned for them.
+    alignas(std::max_align_t) std::byte buffer[bus_record::capacity];
+    std::memcpy(buffer, record.args, args_layout::length);
+    fn(*std::launder(reinterpret_cast<std::tuple_element_t<I, layout_t>*>(
+        buffer + args_layout::offsets[I]))...);
+}
+
+/// whether a record holds the arguments of layout_t, before reading them.
+template <class layout_t>
+bool
+valid_length(const bus_record& record)
+{
+    return record.length == arg_layout<layout_t>::length;
+}
+
+/// calls fn with the arguments of a record written as layout_t.
+template <class layout_t, class fn_t>
+void
+read_args(const bus_record& record, fn_t&& fn)
+{
+    read_args<layout_t>(record, std::forward<fn_t>(fn),
+                        std::make_index_sequence<std::tuple_size_v<layout_t>>());
+}
+
+} // namespace marshal_detail
+
+/**
+ * @class bus_marshal
+ *
+ * Marshals calls of the listed methods of a bus into @ref bus_record and
+ * dispatches them back, on the same bus in another process for instance.
+ * Both sides name the same methods in the same order, a method is recorded
+ * by its index. The interface is identified by a hash of its type name, the
+ * same in processes built by the same compiler.
+ *
+ * Usage Example:
+ * @code
+ * using input_marshal =
+ *     bus_marshal<input_iface, &input_iface::key_down, &input_iface::scroll>;
+ *
+ * bus_record record = input_marshal::encode(0, &input_iface::key_down, 42);
+ * input_marshal::dispatch(record); // input_bus::broadcast(&key_down, 42)
+ * @endcode
+ *
+ * A GLOBAL bus is dispatched with broadcast(), an ONE2ONE one with
+ * event(id) and a GROUP one with multicast(id).
+ */
+template <EBUS_IFACE interface, auto... methods>
+class bus_marshal
+{
+public:
+    using iface_t = interface;
+    using bus_t   = ebus<interface>;
+
+    static constexpr uint16_t no_method = UINT16_MAX;
+
+    static uint64_t iface_id()
+    {
+        static const uint64_t id = fnv1a(typeid(interface).name());
+        return id;
+    }
+
+    /// @brief the index of a method, no_method if it is not listed.
+    template <class function_t>
+    static uint16_t index_of(function_t func)
+    {
+        uint16_t index = 0;
+        uint16_t found = no_method;
+        ((found = found == no_method && same(methods, func) ? index : found, index++),
+         ...);
+        return found;
+    }
+
+    /// @brief the record of a call, the arguments are converted to the
+    /// parameter types of the method first.
+    template <class function_t, class... args_t>
+    static bus_record encode(uint64_t id, function_t func, args_t&&... args)
+    {
+        using layout_t = marshal_detail::layout_of<function_t>;
+
+        bus_record record{};
+        record.iface  = iface_id();
+        record.id     = id;
+        record.method = index_of(func);
+        assert(record.method != no_method && "the method is not marshalled");
+        marshal_detail::write_args<layout_t>(record, std::forward<args_t>(args)...);
+        return record;
+    }
+
+    /// @brief hands a dispatch to the sink of the @ref bus_tap, methods not
+    /// listed are left out.
+    template <class function_t, class... args_t>
+    static void tap(uint64_t id, const function_t& func, const args_t&... args)
+    {
+        tap_flagged(0, id, func, args...);
+    }
+
+    /// @brief tap() of an early exit dispatch, replayed as one.
+    template <class function_t, class... args_t>
+    static void tap_until(uint64_t id, const function_t& func, const args_t&... args)
+    {
+        tap_flagged(bus_record::until, id, func, args...);
+    }
+
+    /// @brief calls the recorded method on the local bus, with
+    /// broadcast_until() or multicast_until() when flagged bus_record::until.
+    /// Records come from other processes or files, one of another interface,
+    /// with a method index out of range or arguments of the wrong length is
+    /// not dispatched and false is returned.
+    static bool dispatch(const bus_record& record)
+    {
+        static constexpr std::array<bool (*)(const bus_record&), sizeof...(methods)>
+            table = make_table(std::make_index_sequence<sizeof...(methods)>());
+        if (record.iface != iface_id() || record.method >= table.size())
+            return false;
+        return table[record.method](record);
+    }
+
+private:
+    template <class method_t, class function_t>
+    static bool same(method_t method, function_t func)
+    {
+        if constexpr (std::is_same_v<method_t, function_t>)
+            return method == func;
+        else
+            return false;
+    }
+
+    template <size_t... I>
+    static constexpr auto make_table(std::index_sequence<I...>)
+    {
+        return std::array<bool (*)(const bus_record&), sizeof...(I)>{
+            &dispatch_method<I>...};
+    }
+
+    template <class function_t, class... args_t>
+    static void tap_flagged(uint16_t flags, uint64_t id, const function_t& func,
+                            const args_t&... args)
+    {
+        bus_sink_fn sink = bus_tap::sink();
+        if (!sink) [[likely]]
+            return;
+        if constexpr (std::is_member_function_pointer_v<function_t>)
+        {
+            if (index_of(func) == no_method)
+                return;
+            bus_record record = encode(id, func, args...);
+            record.flags      = flags;
+            sink(record);
+        }
+    }
+
+    template <size_t M>
+    static bool dispatch_method(const bus_record& record)
+    {
+        constexpr auto method = std::get<M>(std::make_tuple(methods...));
+        using method_t = std::remove_cv_t<decltype(method)>;
+        using layout_t = marshal_detail::layout_of<method_t>;
+        using result_t = typename ebus_method_traits<method_t>::result_t;
+        // the methods and buses broadcast_until() and multicast_until() take.
+        constexpr bool stoppable =
+            interface::type != ebus_type::ONE2ONE &&
+            (std::is_same_v<result_t, bool> || std::is_same_v<result_t, ebus_result>);
+
+        bool until = record.flags & bus_record::until;
+        if (!marshal_detail::valid_length<layout_t>(record) || (until && !stoppable))
+            return false;
+        marshal_detail::read_args<layout_t>(
+            record,
+            [&record, until, method](auto&... args)
+            {
+                if constexpr (stoppable)
+                {
+                    if (until)
+                    {
+                        if constexpr (interface::type == ebus_type::GLOBAL)
+                            bus_t::broadcast_until(method, args...);
+                        else
+                            bus_t::multicast_until(record.id, method, args...);
+                        return;
+                    }
+                }
+                if constexpr (interface::type == ebus_type::GLOBAL)
+                    bus_t::broadcast(method, args...);
+                else if constexpr (interface::type == ebus_type::ONE2ONE)
+                    bus_t::event(record.id, method, args...);
+                else
+                    bus_t::multicast(record.id, method, args...);
+            });
+        return true;
+    }
+};
+
+/**
+ * @class bus_dispatch_table
+ *
+ * Dispatches records of several interfaces, each registered with its
+ * @ref bus_marshal.
+ */
+class bus_dispatch_table
+{
+public:
+    /// returns false for a record it cannot dispatch.
+    using dispatch_fn = std::function<bool(const bus_record&)>;
+
+    template <class marshal_t>
+    void add()
+    {
+        m_dispatch[marshal_t::iface_id()] = &marshal_t::dispatch;
+    }
+
+    /// @brief dispatches the records of this interface id with fn.
+    void add(uint64_t iface, dispatch_fn&& fn) { m_dispatch[iface] = std::move(fn); }
+
+    /// @brief returns false for a record of an interface not added, or one
+    /// its interface rejects.
+    bool dispatch(const bus_record& record) const
+    {
+        auto found = m_dispatch.find(record.iface);
+        if (found == m_dispatch.end())
+            return false;
+        return found->second(record);
+    }
+
+private:
+    std::unordered_map<uint64_t, dispatch_fn> m_dispatch;
+};
+
+} // namespace EBUS_NS
+
+/// declares the bus_marshal of an interface, the listed methods of the bus are
+/// then tapped, see bus_tap. Next to the interface, in its namespace, so every
+/// dispatch sees it.
+#define EBUS_TAP(...)                                                                \
+    inline std::type_identity<__VA_ARGS__> ebus_marshal_of(__VA_ARGS__::iface_t*)    \
+    {                                                                                \
+        return {};                                                                   \
+    }
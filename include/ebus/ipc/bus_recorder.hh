@@ -0,0 +1,219 @@
+#pragma once
+
+#include "bus_marshal.hh"
+
+#include "../event.hh"
+#include "../task.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/**
+ * @struct bus_log_header
+ *
+ * The start of a log written by @ref bus_recorder, followed by the records.
+ * Threads append blocks of records in the order they flush them, the records
+ * are not sorted by time in the file.
+ */
+struct bus_log_header
+{
+    static constexpr uint64_t magic   = 0x65627573'6c6f6721; // "ebuslog!"
+    static constexpr uint32_t version = 1;
+
+    uint64_t              m_magic;
+    uint32_t              m_version;
+    uint32_t              m_record_size; // sizeof(bus_record)
+    std::atomic<uint64_t> m_length;      // bytes of records reserved
+    uint64_t              m_capacity;    // bytes of records at most
+    uint64_t              m_start;       // task_clock nanoseconds
+    uint64_t              m_reserved[3];
+};
+
+static_assert(sizeof(bus_log_header) == 64);
+
+/**
+ * @class bus_recorder
+ *
+ * Records the traffic of buses to a memory-mapped log, to be replayed later
+ * by @ref bus_replayer to reproduce a run.
+ *
+ * The buses recorded are the ones declared with @ref EBUS_TAP: the recorder
+ * becomes the sink of the @ref bus_tap. Event objects are recorded by name
+ * with track(). Each thread fills a buffer of its own and appends it to the
+ * log as a block, one atomic add on the log length, so recording threads do
+ * not contend. Records past the capacity are counted as dropped.
+ *
+ * A single recorder records at a time. POSIX only, the recorder is invalid
+ * elsewhere.
+ *
+ * Usage Example:
+ * @code
+ * // next to input_iface
+ * using input_marshal = bus_marshal<input_iface, &input_iface::key_down>;
+ * EBUS_TAP(input_marshal);
+ *
+ * bus_recorder recorder("session.ebuslog", 1 << 20);
+ * recorder.track(on_frame, "on_frame");
+ * run_session();
+ * recorder.stop();
+ * @endcode
+ */
+class bus_recorder
+{
+public:
+    /// @brief creates the log, up to capacity records, and starts recording.
+    bus_recorder(const std::string& path, size_t capacity);
+    ~bus_recorder();
+
+    bus_recorder(const bus_recorder&)            = delete;
+    bus_recorder& operator=(const bus_recorder&) = delete;
+
+    bool valid() const { return m_header != nullptr; }
+
+    /// @brief records the dispatches of an event object, under a name the
+    /// @ref bus_replayer binds it back with. The event outlives the recorder,
+    /// or stop() is called first.
+    template <typename... args_t>
+    void track(event<args_t...>& ev, std::string_view name);
+
+    /// @brief records a marshalled call, stamping its time.
+    static void record(const bus_record& record);
+
+    /// @brief writes the buffered records and closes the log, truncated to
+    /// the records written.
+    void stop();
+
+    /// @brief records written to the log.
+    uint64_t recorded() const { return m_recorded.load(std::memory_order_relaxed); }
+    /// @brief records past the capacity.
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct buffer;
+
+    // the buffer of the calling thread.
+    static buffer& local_buffer();
+
+    struct tracked
+    {
+        virtual ~tracked() = default;
+    };
+
+    template <typename... args_t>
+    struct tracked_event : tracked
+    {
+        event_handler<args_t...> m_handler;
+    };
+
+    // appends a block of records, returns how many fit.
+    size_t write(const bus_record* records, size_t count);
+
+    bus_log_header*                       m_header = nullptr;
+    size_t                                m_bytes  = 0; // mapped
+    int                                   m_fd     = -1;
+    std::vector<buffer*>                  m_buffers; // under the recording lock
+    std::vector<std::unique_ptr<tracked>> m_tracked;
+    std::atomic<uint64_t>                 m_recorded = 0;
+    std::atomic<uint64_t>                 m_dropped  = 0;
+};
+
+template <typename... args_t>
+void
+bus_recorder::track(event<args_t...>& ev, std::string_view name)
+{
+    using layout_t = std::tuple<std::decay_t<args_t>...>;
+
+    auto     entry = std::make_unique<tracked_event<args_t...>>();
+    uint64_t iface = fnv1a(name);
+    entry->m_handler = event_handler<args_t...>(
+        [iface](args_t... args)
+        {
+            bus_record record{};
+            record.iface = iface;
+            marshal_detail::write_args<layout_t>(record, args...);
+            bus_recorder::record(record);
+        });
+    ev.connect(entry->m_handler);
+    m_tracked.push_back(std::move(entry));
+}
+
+/// how fast bus_replayer::replay() dispatches.
+enum class replay_speed : uint8_t
+{
+    original, // keeping the recorded gaps
+    fastest,  // back to back
+};
+
+/**
+ * @class bus_replayer
+ *
+ * Dispatches the records of a @ref bus_recorder log in time order, on the
+ * buses added with their @ref bus_marshal and the event objects bound by
+ * name.
+ *
+ * Usage Example:
+ * @code
+ * bus_replayer replayer("session.ebuslog");
+ * replayer.add<input_marshal>();
+ * replayer.bind(on_frame, "on_frame");
+ * replayer.replay(replay_speed::original);
+ * @endcode
+ */
+class bus_replayer
+{
+public:
+    explicit bus_replayer(const std::string& path);
+    ~bus_replayer();
+
+    bus_replayer(const bus_replayer&)            = delete;
+    bus_replayer& operator=(const bus_replayer&) = delete;
+
+    bool valid() const { return m_memory != nullptr; }
+    /// @brief records in the log.
+    size_t size() const { return m_records.size(); }
+
+    template <class marshal_t>
+    void add()
+    {
+        m_table.add<marshal_t>();
+    }
+
+    /// @brief dispatches the records tracked under that name on ev.
+    template <typename... args_t>
+    void bind(event<args_t...>& ev, std::string_view name)
+    {
+        using layout_t = std::tuple<std::decay_t<args_t>...>;
+        m_table.add(fnv1a(name),
+                    [&ev](const bus_record& record)
+                    {
+                        if (!marshal_detail::valid_length<layout_t>(record))
+                            return false;
+                        marshal_detail::read_args<layout_t>(
+                            record, [&ev](auto&... args) { ev.dispatch(args...); });
+                        return true;
+                    });
+    }
+
+    /// @brief dispatches every record, returns how many were.
+    size_t replay(replay_speed speed = replay_speed::fastest);
+
+    /// @brief records of interfaces not added nor bound, or malformed,
+    /// skipped.
+    uint64_t unknown() const { return m_unknown; }
+
+private:
+    void*                          m_memory = nullptr;
+    size_t                         m_bytes  = 0; // mapped
+    std::vector<const bus_record*> m_records;    // sorted by time
+    bus_dispatch_table             m_table;
+    uint64_t                       m_unknown = 0;
+};
+
+} // namespace EBUS_NS
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "bus_marshal.hh"
+
+#include "../task.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/**
+ * @class shm_ring
+ *
+ * A bounded multi-producer multi-consumer ring of @ref bus_record in a named
+ * POSIX shared memory segment, for processes of the same host. The same
+ * sequence-numbered cells as @ref mpmc_queue, laid out in the segment.
+ *
+ * Consumers sleep on a futex doorbell. notify() rings it, a single atomic
+ * increment while no consumer sleeps, a syscall otherwise, so producers
+ * push a batch and ring once.
+ *
+ * Linux only, create() and open() return an invalid ring elsewhere. An
+ * invalid ring has no capacity, pushes and pops fail and wait() returns at
+ * once.
+ *
+ * Usage Example:
+ * @code
+ * // the service owning the ring
+ * shm_ring ring = shm_ring::create("/game-input", 4096);
+ * // the others
+ * shm_ring ring = shm_ring::open("/game-input");
+ * @endcode
+ */
+class shm_ring
+{
+public:
+    /// @brief creates the segment, replacing any of that name. The creator
+    /// unlinks the name when destroyed, the processes which opened it keep
+    /// the memory. The capacity is rounded up to a power of two.
+    static shm_ring create(const std::string& name, size_t capacity);
+    /// @brief maps a segment made by create(), invalid if there is none.
+    static shm_ring open(const std::string& name);
+
+    shm_ring() = default;
+    ~shm_ring();
+
+    shm_ring(shm_ring&& other) noexcept;
+    shm_ring& operator=(shm_ring&& other) noexcept;
+
+    shm_ring(const shm_ring&)            = delete;
+    shm_ring& operator=(const shm_ring&) = delete;
+
+    bool   valid() const { return m_header != nullptr; }
+    size_t capacity() const { return valid() ? m_mask + 1 : 0; }
+    /// @brief approximated number of records, exact when quiescent.
+    size_t size() const;
+
+    /// @brief returns false when full, without ringing the doorbell.
+    bool try_push(const bus_record& record);
+    /// @brief returns false when empty.
+    bool try_pop(bus_record& record);
+    /// @brief pops up to out.size() records, returns how many.
+    size_t pop_n(std::span<bus_record> out);
+
+    /// @brief wakes the sleeping consumers.
+    void notify();
+    /// @brief sleeps until there are records, a notify() or the timeout.
+    /// Returns whether there are records.
+    bool wait(task_clock::duration timeout);
+
+private:
+    struct header;
+    struct cell;
+
+    // the header, then the cells.
+    static size_t segment_bytes(size_t capacity);
+
+    void reset();
+
+    header*     m_header = nullptr;
+    cell*       m_cells  = nullptr;
+    size_t      m_mask   = 0;
+    size_t      m_bytes  = 0; // mapped
+    std::string m_name;       // unlinked by the creator
+};
+
+/**
+ * @class shm_sender
+ *
+ * Marshals calls into a @ref shm_ring, in batches: records are pushed and
+ * the doorbell rung once every batch calls, or on flush(). Not thread-safe,
+ * one sender per producing thread.
+ *
+ * While the ring is full a flush waits for the consumers up to the timeout,
+ * then drops what is left, counted by dropped(). The destructor does not
+ * wait, it pushes what fits.
+ *
+ * Usage Example:
+ * @code
+ * using input_marshal = bus_marshal<input_iface, &input_iface::key_down>;
+ *
+ * shm_sender sender(ring, 64);
+ * for (const auto& key : keys)
+ *     sender.broadcast<input_marshal>(&input_iface::key_down, key);
+ * sender.flush();
+ * @endcode
+ */
+class shm_sender
+{
+public:
+    explicit shm_sender(shm_ring& ring, size_t batch = 1,
+                        task_clock::duration timeout = std::chrono::milliseconds(100));
+    ~shm_sender() { flush_until(task_clock::now()); }
+
+    shm_sender(const shm_sender&)            = delete;
+    shm_sender& operator=(const shm_sender&) = delete;
+
+    template <class marshal_t, class function_t, class... args_t>
+    void broadcast(function_t&& func, args_t&&... args)
+    {
+        static_assert(marshal_t::iface_t::type == ebus_type::GLOBAL,
+                      "broadcast() is reserved only for global type ebus");
+        add(marshal_t::encode(0, func, std::forward<args_t>(args)...));
+    }
+
+    template <class marshal_t, class function_t, class... args_t>
+    void event(size_t id, function_t&& func, args_t&&... args)
+    {
+        static_assert(marshal_t::iface_t::type == ebus_type::ONE2ONE,
+                      "event(id) is reserved only for id based ebus");
+        add(marshal_t::encode(id, func, std::forward<args_t>(args)...));
+    }
+
+    template <class marshal_t, class function_t, class... args_t>
+    void multicast(size_t id, function_t&& func, args_t&&... args)
+    {
+        static_assert(marshal_t::iface_t::type == ebus_type::GROUP,
+                      "multicast(id) is reserved only for group type ebus");
+        add(marshal_t::encode(id, func, std::forward<args_t>(args)...));
+    }
+
+    /// @brief pushes the pending records and rings the doorbell, yielding
+    /// while the ring is full, up to the timeout. Returns false when records
+    /// were dropped.
+    bool flush() { return flush_until(task_clock::now() + m_timeout); }
+
+    /// @brief records dropped, the ring full past the timeout.
+    uint64_t dropped() const { return m_dropped; }
+
+private:
+    void add(const bus_record& record);
+    bool flush_until(task_clock::time_point deadline);
+
+    shm_ring&                  m_ring;
+    const size_t               m_batch;
+    const task_clock::duration m_timeout;
+    std::vector<bus_record>    m_pending;
+    uint64_t                   m_dropped = 0;
+};
+
+/**
+ * @class shm_receiver
+ *
+ * Pops the records of a @ref shm_ring and dispatches them on the local
+ * buses, for the interfaces added with their @ref bus_marshal.
+ */
+class shm_receiver
+{
+public:
+    explicit shm_receiver(shm_ring& ring);
+
+    template <class marshal_t>
+    void add()
+    {
+        m_table.add<marshal_t>();
+    }
+
+    /// @brief dispatches the records waiting, up to max, returns how many.
+    size_t poll(size_t max = SIZE_MAX);
+    /// @brief waits up to the timeout for records, then polls them.
+    size_t wait_and_poll(task_clock::duration timeout, size_t max = SIZE_MAX);
+
+    /// @brief records of interfaces not added, or malformed, dropped.
+    uint64_t unknown() const { return m_unknown; }
+
+private:
+    shm_ring&          m_ring;
+    bus_dispatch_table m_table;
+    uint64_t           m_unknown = 0;
+};
+
+} // namespace EBUS_NS
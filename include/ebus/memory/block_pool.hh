@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/**
+ * @class block_pool
+ *
+ * Fixed size blocks served from thread local caches, for objects that are
+ * created and destroyed at a high rate, like tasks.
+ *
+ * Every thread allocates from its own cache without any synchronization. A
+ * block freed on its owner thread goes straight back to the owner's free
+ * list, a block freed on another thread (a task allocated by the submitter
+ * and released by a worker) is pushed onto the owner's lock-free remote
+ * stack, which the owner takes in one exchange once its free list runs dry.
+ *
+ * Caches are never destroyed: when a thread exits, its cache, with the blocks
+ * still out there, is parked on a global list and adopted by the next thread
+ * needing one. Memory is only taken from the system, in slabs, while the pool
+ * grows; in steady state allocate() and deallocate() never call malloc.
+ *
+ * All the pools of the same block_size are the same pool.
+ */
+template <size_t block_size>
+class block_pool
+{
+    struct cache;
+
+    // the header stays in front of the block for its whole life.
+    struct alignas(std::max_align_t) header
+    {
+        cache*  m_owner;
+        header* m_next; // only when free
+    };
+
+    struct cache
+    {
+        header*              m_free   = nullptr; // owner thread only
+        std::atomic<header*> m_remote = nullptr; // freed by other threads
+    };
+
+    static constexpr size_t slot_size =
+        sizeof(header) +
+        (block_size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) *
+            alignof(std::max_align_t);
+    static constexpr size_t slab_blocks = slot_size < 1024 ? 16384 / slot_size : 16;
+
+public:
+    static void* allocate()
+    {
+        cache* c = t_cache ? t_cache : attach();
+        if (!c->m_free)
+            c->m_free = c->m_remote.exchange(nullptr, std::memory_order_acquire);
+        if (!c->m_free)
+            grow(c);
+
+        header* h  = c->m_free;
+        c->m_free  = h->m_next;
+        h->m_owner = c;
+        return h + 1;
+    }
+
+    static void deallocate(void* p)
+    {
+        if (!p)
+            return;
+        header* h     = static_cast<header*>(p) - 1;
+        cache*  owner = h->m_owner;
+        if (owner == t_cache)
+        {
+            h->m_next     = owner->m_free;
+            owner->m_free = h;
+            return;
+        }
+        header* head = owner->m_remote.load(std::memory_order_relaxed);
+        do
+        {
+            h->m_next = head;
+        } while (!owner->m_remote.compare_exchange_weak(
+            head, h, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /// @brief number of blocks taken from the system so far, by all threads.
+    static size_t reserved()
+    {
+        return registry().m_reserved.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct registry_t
+    {
+        std::mutex          m_lock;
+        std::vector<cache*> m_spares; // caches of exited threads
+        std::atomic_size_t  m_reserved = 0;
+    };
+
+    // parks the cache when the thread exits.
+    struct detach_guard
+    {
+        ~detach_guard()
+        {
+            if (!t_cache)
+                return;
+            registry_t&                 r = registry();
+            std::lock_guard<std::mutex> lock(r.m_lock);
+            r.m_spares.push_back(t_cache);
+            t_cache = nullptr;
+        }
+    };
+
+    // never destroyed, blocks may be released by static destructors.
+    static registry_t& registry()
+    {
+        static registry_t* r = new registry_t;
+        return *r;
+    }
+
+    static cache* attach()
+    {
+        static thread_local detach_guard guard;
+        (void)guard;
+
+        registry_t&                 r = registry();
+        std::lock_guard<std::mutex> lock(r.m_lock);
+        if (r.m_spares.empty())
+        {
+            t_cache = new cache;
+        }
+        else
+        {
+            t_cache = r.m_spares.back();
+            r.m_spares.pop_back();
+        }
+        return t_cache;
+    }
+
+    static void grow(cache* c)
+    {
+        char* slab = static_cast<char*>(
+            ::operator new(slot_size * slab_blocks, std::align_val_t{alignof(header)}));
+        for (size_t i = 0; i < slab_blocks; i++)
+        {
+            header* h = reinterpret_cast<header*>(slab + i * slot_size);
+            h->m_next = c->m_free;
+            c->m_free = h;
+        }
+        registry().m_reserved.fetch_add(slab_blocks, std::memory_order_relaxed);
+    }
+
+    static inline thread_local cache* t_cache = nullptr;
+};
+
+} // namespace EBUS_NS
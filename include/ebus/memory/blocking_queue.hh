@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/**
+ * @class blocking_queue
+ *
+ * Adds a blocking pop() on top of a non-blocking queue such as @ref
+ * mpmc_queue. Producers and consumers go through the wrapped queue directly,
+ * consumers park on an atomic wait (a futex on linux) when the queue is empty
+ * and producers only issue a wake up when someone is actually parked and not
+ * already being woken up. This is meant for queues with a single consumer
+ * parking at a time, like the @ref basic_task_worker queues.
+ *
+ * Producers never wait on a full queue: the items spill to a locked overflow,
+ * taken after the queue, so the consumer may push to its own queue. Once
+ * spilled, items keep spilling until the overflow is drained, for the order.
+ * The overflow keeps its storage when drained, bursts spilling again do not
+ * allocate.
+ */
+template <class queue_t>
+class blocking_queue
+{
+public:
+    using value_type = typename queue_t::value_type;
+
+    template <typename... args_t>
+    explicit blocking_queue(args_t&&... args) :
+        m_queue(std::forward<args_t>(args)...)
+    {
+    }
+
+    void push(value_type item)
+    {
+        add(std::move(item));
+        wake();
+    }
+
+    /// @brief push a range of items, moving them, with a single wake up.
+    template <typename iterator_t>
+    void push_n(iterator_t first, iterator_t last)
+    {
+        for (; first != last; ++first)
+        {
+            add(std::move(*first));
+        }
+        wake();
+    }
+
+    bool try_pop(value_type& item)
+    {
+        if (m_queue.try_pop(item))
+            return true;
+        if (!m_spilled.load(std::memory_order_acquire))
+            return false;
+
+        std::lock_guard<std::mutex> lock(m_overflow_lock);
+        if (m_overflow_head == m_overflow.size())
+            return false;
+        item = std::move(m_overflow[m_overflow_head++]);
+        if (m_overflow_head == m_overflow.size())
+        {
+            m_overflow.clear();
+            m_overflow_head = 0;
+            m_spilled.store(false, std::memory_order_release);
+        }
+        return true;
+    }
+
+    template <typename iterator_t>
+    size_t pop_n(iterator_t out, size_t max)
+    {
+        size_t n = m_queue.pop_n(out, max);
+        if (n == max || !m_spilled.load(std::memory_order_acquire))
+            return n;
+        std::advance(out, n);
+        for (; n < max && try_pop(*out); n++, ++out)
+        {
+        }
+        return n;
+    }
+
+    value_type pop()
+    {
+        value_type item;
+        while (!try_pop(item))
+        {
+            uint32_t epoch = m_epoch.load(std::memory_order_acquire);
+            // allow the next wake up. acq_rel so the recheck below sees the
+            // items of producers that skipped their wake up because of a
+            // previous one.
+            m_signaled.exchange(false, std::memory_order_acq_rel);
+            m_parked.fetch_add(1, std::memory_order_seq_cst);
+            // pairs with the fence in wake(), either the producer sees us
+            // parked or we see its item.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (try_pop(item))
+            {
+                m_parked.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            m_epoch.wait(epoch, std::memory_order_acquire);
+            m_parked.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_overflow_lock);
+        return m_queue.size() + m_overflow.size() - m_overflow_head;
+    }
+
+    /// number of items which spilled to the overflow so far.
+    size_t spills() const { return m_spills.load(std::memory_order_relaxed); }
+
+    /// number of wake ups issued by producers so far.
+    size_t wakeups() const { return m_wakeups.load(std::memory_order_relaxed); }
+
+    queue_t&       queue() { return m_queue; }
+    const queue_t& queue() const { return m_queue; }
+
+protected:
+    void add(value_type&& item)
+    {
+        if (!m_spilled.load(std::memory_order_acquire) &&
+            m_queue.try_push(std::move(item)))
+            return;
+
+        std::lock_guard<std::mutex> lock(m_overflow_lock);
+        m_overflow.push_back(std::move(item));
+        m_spilled.store(true, std::memory_order_release);
+        m_spills.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void wake()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // one wake up in flight is enough, the parked consumer drains the
+        // queue once it runs.
+        if (m_parked.load(std::memory_order_relaxed) > 0 &&
+            !m_signaled.exchange(true, std::memory_order_acq_rel))
+        {
+            m_epoch.fetch_add(1, std::memory_order_release);
+            m_epoch.notify_one();
+            m_wakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    queue_t               m_queue;
+    std::atomic<uint32_t> m_epoch    = 0;
+    std::atomic<uint32_t> m_parked   = 0;
+    std::atomic_bool      m_signaled = false;
+    std::atomic_size_t    m_wakeups  = 0;
+
+    mutable std::mutex      m_overflow_lock;
+    std::vector<value_type> m_overflow; // taken from m_overflow_head
+    size_t                  m_overflow_head = 0;
+    std::atomic_bool        m_spilled       = false;
+    std::atomic_size_t      m_spills        = 0;
+};
+
+} // namespace EBUS_NS
@@ -0,0 +1,23 @@
+#pragma once
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+namespace EBUS_NS
+{
+
+///@brief hint the cpu that we are in a spin-wait loop.
+inline void
+cpu_relax()
+{
+#if defined(_MSC_VER)
+    YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+} // namespace EBUS_NS
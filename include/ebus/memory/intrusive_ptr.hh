@@ -248,6 +248,40 @@ swap(intrusive_ptr<T>& lhs, intrusive_ptr<T>& rhs)
     lhs.swap(rhs);
 }
 
+/**
+ * moving_ref
+ *
+ * Hands an intrusive_ptr to a by-value parameter through std::bind, which
+ * only passes lvalues: the parameter is moved from the pointer instead of
+ * copied, without touching the reference count. The pointer is empty
+ * afterwards, so only the first handler of a broadcast gets it.
+ *
+ * @code
+ * task_scheduler_bus::broadcast(&task_scheduler_iface::m_add_task, move_ref(task));
+ * @endcode
+ */
+template <class T>
+class moving_ref
+{
+public:
+    explicit moving_ref(intrusive_ptr<T>& ptr) :
+        m_ptr(ptr)
+    {
+    }
+
+    operator intrusive_ptr<T>() const { return std::move(m_ptr); }
+
+private:
+    intrusive_ptr<T>& m_ptr;
+};
+
+template <class T>
+moving_ref<T>
+move_ref(intrusive_ptr<T>& ptr)
+{
+    return moving_ref<T>(ptr);
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // pointer cast
 ///////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/**
+ * @class lane_container
+ *
+ * A container of prioritized lanes, meant to be used as the container of
+ * @ref safe_queue. front() always returns the item of the highest non-empty
+ * lane, lane 0 being the most urgent one. Inside a lane items come out by
+ * smallest key (a deadline for example), ties by insertion order.
+ *
+ * To protect the lower lanes from starvation, each time a lane is passed over
+ * while not empty it ages by one, once it is passed over traits_t::aging
+ * times in a row, it gets served once.
+ *
+ * traits_t provides:
+ * - `lanes`, the number of lanes.
+ * - `aging`, the number of times a lane can be passed over.
+ * - `key_type`, `lane(const T&)` and `key(const T&)`.
+ */
+template <typename T, class traits_t>
+class lane_container
+{
+public:
+    using value_type = T;
+    using key_type   = typename traits_t::key_type;
+
+    static constexpr size_t lanes = traits_t::lanes;
+
+    void push_back(T item)
+    {
+        std::vector<entry>& lane = m_lanes[traits_t::lane(item)];
+
+        lane.push_back(entry{traits_t::key(item), m_seq++, std::move(item)});
+        std::push_heap(lane.begin(), lane.end(), later);
+        m_size++;
+    }
+
+    T& front() { return m_lanes[select()].front().m_item; }
+
+    void pop_front()
+    {
+        size_t              selected = select();
+        std::vector<entry>& lane     = m_lanes[selected];
+
+        std::pop_heap(lane.begin(), lane.end(), later);
+        lane.pop_back();
+        m_size--;
+
+        // age the lower lanes we have passed over
+        m_passed[selected] = 0;
+        for (size_t i = selected + 1; i < lanes; i++)
+        {
+            m_passed[i] += m_lanes[i].empty() ? 0 : 1;
+        }
+    }
+
+    bool   empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+
+    /// @brief makes room for n more items in each lane. The room is written
+    /// once, so its pages are first touched, and placed, by the calling
+    /// thread.
+    void reserve(size_t n)
+    {
+        for (std::vector<entry>& lane : m_lanes)
+        {
+            size_t size = lane.size();
+            lane.resize(size + n);
+            lane.resize(size);
+        }
+    }
+
+protected:
+    struct entry
+    {
+        key_type m_key;
+        uint64_t m_seq;
+        T        m_item;
+    };
+
+    // heap order, the earliest key then the earliest insertion on top.
+    static bool later(const entry& a, const entry& b)
+    {
+        if (a.m_key != b.m_key)
+            return b.m_key < a.m_key;
+        return a.m_seq > b.m_seq;
+    }
+
+    size_t select() const
+    {
+        size_t first = lanes;
+        for (size_t i = 0; i < lanes; i++)
+        {
+            if (m_lanes[i].empty())
+                continue;
+            if (m_passed[i] >= traits_t::aging)
+                return i;
+            first = std::min(first, i);
+        }
+        return first;
+    }
+
+    std::array<std::vector<entry>, lanes> m_lanes;
+    std::array<size_t, lanes>             m_passed = {};
+    uint64_t                              m_seq    = 0;
+    size_t                                m_size   = 0;
+};
+
+} // namespace EBUS_NS
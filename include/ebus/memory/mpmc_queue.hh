@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+namespace EBUS_NS
+{
+
+/**
+ * @class mpmc_queue
+ *
+ * A bounded, array based, lock-free multi-producer multi-consumer queue.
+ *
+ * The queue is the classic sequence-numbered ring buffer: each cell carries a
+ * sequence number telling producers and consumers whether it is free to write
+ * or ready to read, so claiming a slot is a single CAS on the enqueue or
+ * dequeue cursor and no thread ever waits on a lock.
+ *
+ * Unlike @ref safe_queue the queue never blocks in pop(), it only spins. Wrap
+ * it in @ref blocking_queue if the consumer needs to sleep on an empty queue.
+ *
+ * The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class mpmc_queue
+{
+    static_assert(std::is_default_constructible_v<T>,
+                  "mpmc_queue requires default constructible element");
+
+public:
+    using value_type = T;
+
+    explicit mpmc_queue(size_t capacity = 1024) :
+        m_mask(round_capacity(capacity) - 1),
+        m_cells(new cell[m_mask + 1])
+    {
+        for (size_t i = 0; i <= m_mask; i++)
+        {
+            m_cells[i].m_seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~mpmc_queue() = default;
+
+    mpmc_queue(const mpmc_queue&)            = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+    /// @brief push the item if there is room, returns false when full.
+    ///
+    /// The item is only moved from on success.
+    template <typename U>
+    bool try_push(U&& item)
+    {
+        cell*  c   = nullptr;
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            c               = &m_cells[pos & m_mask];
+            size_t    seq   = c->m_seq.load(std::memory_order_acquire);
+            ptrdiff_t delta = (ptrdiff_t)seq - (ptrdiff_t)pos;
+            if (delta == 0)
+            {
+                if (m_enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (delta < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        c->m_data = std::forward<U>(item);
+        c->m_seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief push the item, yielding while the queue is full. The consumers
+    /// must run elsewhere, one of them pushing would wait for itself, see
+    /// @ref blocking_queue which spills instead.
+    void push(T item)
+    {
+        while (!try_push(std::move(item)))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    /// @brief push a range of items, moving them, yielding while the queue is full.
+    template <typename iterator_t>
+    void push_n(iterator_t first, iterator_t last)
+    {
+        for (; first != last; ++first)
+        {
+            push(std::move(*first));
+        }
+    }
+
+    /// @brief pop up to max items without waiting, returns the number popped.
+    template <typename iterator_t>
+    size_t pop_n(iterator_t out, size_t max)
+    {
+        size_t n = 0;
+        for (; n < max && try_pop(*out); n++, ++out)
+        {
+        }
+        return n;
+    }
+
+    /// @brief pop an item if there is one, returns false when empty.
+    bool try_pop(T& item)
+    {
+        cell*  c   = nullptr;
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            c               = &m_cells[pos & m_mask];
+            size_t    seq   = c->m_seq.load(std::memory_order_acquire);
+            ptrdiff_t delta = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+            if (delta == 0)
+            {
+                if (m_dequeue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (delta < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        item = std::move(c->m_data);
+        // drop whatever is left in the cell so it does not keep references.
+        c->m_data = T{};
+        c->m_seq.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief pop an item, yielding while the queue is empty.
+    T pop()
+    {
+        T item;
+        while (!try_pop(item))
+        {
+            std::this_thread::yield();
+        }
+        return item;
+    }
+
+    /// @brief approximated number of items, exact when the queue is quiescent.
+    size_t size() const
+    {
+        size_t tail = m_dequeue_pos.load(std::memory_order_relaxed);
+        size_t head = m_enqueue_pos.load(std::memory_order_relaxed);
+        return head > tail ? head - tail : 0;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+protected:
+    static constexpr size_t cache_line = 64;
+
+    struct alignas(cache_line) cell
+    {
+        std::atomic_size_t m_seq;
+        T                  m_data;
+    };
+
+    static size_t round_capacity(size_t capacity)
+    {
+        size_t result = 2;
+        while (result < capacity)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t            m_mask;
+    std::unique_ptr<cell[]> m_cells;
+
+    // producers and consumers hammer different cursors, keep them apart.
+    alignas(cache_line) std::atomic_size_t m_enqueue_pos = 0;
+    alignas(cache_line) std::atomic_size_t m_dequeue_pos = 0;
+};
+
+} // namespace EBUS_NS
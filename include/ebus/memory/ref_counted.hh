@@ -0,0 +1,284 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace EBUS_NS
+{
+
+/**
+ * @struct single_thread_count
+ *
+ * A plain counter, for objects which never leave the thread using them.
+ */
+struct single_thread_count
+{
+    void increment() { m_count++; }
+    /// @brief true once the last reference is gone.
+    bool     decrement() { return --m_count == 0; }
+    uint32_t count() const { return m_count; }
+
+    uint32_t m_count = 0;
+};
+
+/**
+ * @struct atomic_count
+ *
+ * A new reference always comes from an existing one, so the increment is
+ * relaxed. The decrement is acq_rel, so whoever drops the last reference
+ * sees everything the others did to the object before deleting it.
+ */
+struct atomic_count
+{
+    void increment() { m_count.fetch_add(1, std::memory_order_relaxed); }
+    bool decrement() { return m_count.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    uint32_t count() const { return m_count.load(std::memory_order_relaxed); }
+
+    std::atomic<uint32_t> m_count = 0;
+};
+
+/**
+ * @class biased_count
+ *
+ * Biased reference counting: the thread creating the object, its owner,
+ * counts with plain increments and decrements, other threads count on an
+ * atomic shared counter. Fits objects mostly referenced by the thread which
+ * made them and only now and then by others.
+ *
+ * The true count is the sum of both. A thread dropping a reference which
+ * would take the shared counter to zero or below queues the object to its
+ * owner instead, the queue holding that reference. The owner merges
+ * its counter into the shared one, for good, when it drops its last
+ * reference or when it finds the object in its queue, which it looks at on
+ * any of its counting and when it exits. After that every thread counts on
+ * the shared counter. A queue whose owner exited is closed, the thread
+ * queuing then merges itself.
+ *
+ * The queues are never freed, one per thread which ever created a biased
+ * object.
+ */
+class biased_count
+{
+public:
+    using destroy_fn = void (*)(biased_count*);
+
+    /// @brief made on the owner thread, destroy deletes the object.
+    explicit biased_count(destroy_fn destroy) :
+        m_owner(owner()),
+        m_destroy(destroy)
+    {
+    }
+
+    void increment()
+    {
+        if (biased())
+        {
+            m_biased++;
+            return;
+        }
+        m_shared.fetch_add(one, std::memory_order_relaxed);
+    }
+
+    /// @brief true once the last reference is gone, the object may also be
+    /// deleted later by its owner, see the class comment.
+    bool decrement()
+    {
+        if (biased())
+        {
+            // the owner stops counting on its own once it has no reference
+            // left, or when it drops one of the shared counter.
+            bool last = m_biased > 0 && --m_biased == 0;
+            if (m_biased > 0)
+                return false;
+            m_merged_by_owner = true;
+            int64_t old = m_shared.fetch_or(merged, std::memory_order_acq_rel);
+            if (last)
+                return !(old & queued) && count_of(old) == 0;
+        }
+
+        int64_t old = m_shared.load(std::memory_order_relaxed);
+        int64_t next;
+        do
+        {
+            // only the owner knows whether this is the last reference, it
+            // goes to the owner's queue instead.
+            if (!(old & (merged | queued)) && count_of(old) <= 1)
+                next = old | queued;
+            else
+                next = old - one;
+        } while (!m_shared.compare_exchange_weak(
+            old, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        if (next & merged)
+            return count_of(next) == 0;
+        if ((next & queued) && !(old & queued))
+            enqueue();
+        return false;
+    }
+
+private:
+    // the shared counter is count << 2 | flags.
+    static constexpr int64_t queued = 1; // sitting in the owner's queue
+    static constexpr int64_t merged = 2; // the owner's counter is merged
+    static constexpr int64_t one    = 4;
+
+    static int64_t count_of(int64_t shared) { return shared >> 2; }
+
+    struct owner_queue
+    {
+        std::atomic<biased_count*> m_head = nullptr;
+    };
+
+    // marks the queue of an exited owner.
+    static biased_count* closed() { return reinterpret_cast<biased_count*>(1); }
+
+    // closes the queue when the thread exits.
+    struct close_guard
+    {
+        ~close_guard()
+        {
+            if (!t_owner)
+                return;
+            owner_queue*  q    = t_owner;
+            biased_count* list = q->m_head.exchange(closed(), std::memory_order_acq_rel);
+            t_owner = nullptr;
+            merge_all(list);
+        }
+    };
+
+    static owner_queue* owner()
+    {
+        if (!t_owner)
+        {
+            static thread_local close_guard guard;
+            (void)guard;
+            t_owner = new owner_queue;
+        }
+        return t_owner;
+    }
+
+    // the owner thread counting its references, merged ones are shared.
+    bool biased()
+    {
+        if (m_owner != t_owner)
+            return false;
+        if (m_owner->m_head.load(std::memory_order_relaxed))
+            merge_all(m_owner->m_head.exchange(nullptr, std::memory_order_acquire));
+        return !m_merged_by_owner;
+    }
+
+    void enqueue()
+    {
+        biased_count* head = m_owner->m_head.load(std::memory_order_relaxed);
+        do
+        {
+            if (head == closed())
+            {
+                // the owner is gone, its counter is final.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                merge();
+                return;
+            }
+            m_next = head;
+        } while (!m_owner->m_head.compare_exchange_weak(
+            head, this, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    static void merge_all(biased_count* list)
+    {
+        while (list && list != closed())
+        {
+            biased_count* next = list->m_next;
+            list->merge();
+            list = next;
+        }
+    }
+
+    // folds the owner's counter into the shared one, then drops the
+    // reference the queue held.
+    void merge()
+    {
+        int64_t add = 0;
+        if (!m_merged_by_owner)
+        {
+            m_merged_by_owner = true;
+            add               = (int64_t)m_biased * one | merged;
+        }
+        int64_t old = m_shared.fetch_add(add - one, std::memory_order_acq_rel);
+        if (count_of(old + add - one) == 0)
+            m_destroy(this);
+    }
+
+    owner_queue* const   m_owner;
+    const destroy_fn     m_destroy;
+    biased_count*        m_next            = nullptr; // in the owner's queue
+    uint32_t             m_biased          = 0;       // owner only
+    bool                 m_merged_by_owner = false;   // owner only
+    std::atomic<int64_t> m_shared          = 0;
+
+    static inline thread_local owner_queue* t_owner = nullptr;
+};
+
+/**
+ * @class ref_counted
+ *
+ * The add_ref() and release() @ref intrusive_ptr needs, counted by a policy:
+ * @ref single_thread_count, @ref atomic_count or @ref biased_count. The last
+ * release deletes the derived object, through its own operator delete.
+ *
+ * Usage Example:
+ * @code
+ * struct mesh : ref_counted<mesh, single_thread_count>
+ * {
+ *     std::vector<float> vertices;
+ * };
+ * intrusive_ptr<mesh> m(new mesh);
+ * @endcode
+ *
+ * A class overriding the virtual add_ref() and release() of @ref task_base
+ * forwards them to the base.
+ */
+template <class derived_t, class count_t = atomic_count>
+class ref_counted
+{
+public:
+    void add_ref() { m_count.increment(); }
+    void release()
+    {
+        if (m_count.decrement())
+            destroy(this);
+    }
+
+protected:
+    ref_counted()
+        requires(!std::is_same_v<count_t, biased_count>)
+    = default;
+    ref_counted()
+        requires(std::is_same_v<count_t, biased_count>)
+        :
+        m_count(&destroy_counted)
+    {
+    }
+
+    // a copy is a new object, with no reference yet.
+    ref_counted(const ref_counted&) :
+        ref_counted()
+    {
+    }
+    ref_counted& operator=(const ref_counted&) { return *this; }
+
+private:
+    static void destroy(ref_counted* self) { delete static_cast<derived_t*>(self); }
+
+    // the counter is the only member, at the address of the base.
+    static void destroy_counted(biased_count* count)
+    {
+        static_assert(std::is_standard_layout_v<ref_counted>);
+        destroy(reinterpret_cast<ref_counted*>(count));
+    }
+
+    count_t m_count;
+};
+
+} // namespace EBUS_NS
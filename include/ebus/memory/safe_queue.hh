@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <deque>
 #include <vector>
 #include <functional>
@@ -11,21 +12,31 @@ namespace EBUS_NS
 {
 
 ///@brief provides thread safe access to adding and popping queue elements
-template <typename T>
+///
+/// container_t decides the order in which items come out, it needs
+/// push_back(), front(), pop_front(), empty() and size(), see @ref
+/// lane_container for a prioritized one.
+template <typename T, class container_t = std::deque<T>>
 class safe_queue
 {
 public:
+    using value_type = T;
+
     safe_queue()  = default;
     ~safe_queue() = default;
 
     void push(T item)
     {
-        // locks the access to the queue
-        std::unique_lock<std::mutex> lock(m_access);
+        size_t wake = 0;
+        {
+            // locks the access to the queue
+            std::unique_lock<std::mutex> lock(m_access);
 
-        m_queue.push_back(item);
-        // notify any thread wants to consume the queue.
-        m_cv.notify_one();
+            m_queue.push_back(std::move(item));
+            wake = signal(1);
+        }
+        if (wake)
+            m_cv.notify_one();
     }
 
     T pop()
@@ -34,25 +45,109 @@ public:
         std::unique_lock<std::mutex> lock(m_access);
 
         // wait until queue is not empty
-        m_cv.wait(lock, [this]() { return !m_queue.empty(); });
+        while (m_queue.empty())
+        {
+            m_waiters++;
+            m_cv.wait(lock);
+            m_waiters--;
+            // zero on a spurious wake up.
+            m_signals -= m_signals > 0 ? 1 : 0;
+        }
 
         // retrieving the item
-        T item = m_queue.front();
+        T item = std::move(m_queue.front());
         m_queue.pop_front();
 
         return item;
     }
 
+    /// @brief push a range of items, moving them, with one lock and a wake up
+    /// per item for the waiters not woken yet.
+    template <typename iterator_t>
+    void push_n(iterator_t first, iterator_t last)
+    {
+        size_t wake = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_access);
+
+            size_t n = 0;
+            for (; first != last; ++first, n++)
+            {
+                m_queue.push_back(std::move(*first));
+            }
+            wake = signal(n);
+        }
+        for (size_t i = 0; i < wake; i++)
+        {
+            m_cv.notify_one();
+        }
+    }
+
+    /// @brief pop up to max items without waiting, returns the number popped.
+    template <typename iterator_t>
+    size_t pop_n(iterator_t out, size_t max)
+    {
+        std::lock_guard<std::mutex> lock(m_access);
+
+        size_t n = std::min(max, m_queue.size());
+        for (size_t i = 0; i < n; i++, ++out)
+        {
+            *out = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        return n;
+    }
+
+    /// @brief pop an item without waiting, returns false if the queue is empty.
+    bool try_pop(T& item)
+    {
+        std::lock_guard<std::mutex> lock(m_access);
+        if (m_queue.empty())
+            return false;
+
+        item = std::move(m_queue.front());
+        m_queue.pop_front();
+        return true;
+    }
+
     size_t size()
     {
         std::lock_guard<std::mutex> lock(m_access);
         return m_queue.size();
     }
 
+    /// @brief makes room for n items when the container can, see @ref
+    /// lane_container::reserve.
+    void reserve(size_t n)
+    {
+        std::lock_guard<std::mutex> lock(m_access);
+        if constexpr (requires { m_queue.reserve(n); })
+            m_queue.reserve(n);
+    }
+
+    /// number of wake ups issued by producers so far.
+    size_t wakeups()
+    {
+        std::lock_guard<std::mutex> lock(m_access);
+        return m_wakeups;
+    }
+
 protected:
-    std::deque<T>           m_queue;
+    // under the lock, only notify the waiters not woken yet, one per item.
+    size_t signal(size_t items)
+    {
+        size_t wake = std::min(items, m_waiters - m_signals);
+        m_signals  += wake;
+        m_wakeups  += wake;
+        return wake;
+    }
+
+    container_t             m_queue;
     std::mutex              m_access;
     std::condition_variable m_cv; // provides notifying mechanism as well.
+    size_t                  m_waiters = 0;
+    size_t                  m_signals = 0; // notified, not woken up yet
+    size_t                  m_wakeups = 0;
 };
 
 } // namespace EBUS_NS
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include "intrusive_list.hh"
+
+namespace EBUS_NS
+{
+
+/**
+ * @class timer_wheel
+ *
+ * A hierarchical timer wheel holding items due at a given tick.
+ *
+ * There are `levels` wheels of 64 slots. Level 0 covers the 64 ticks of the
+ * current block one tick per slot, level 1 the next 64 blocks, and so on.
+ * Adding and cancelling a timer are O(1). When a lower wheel wraps around,
+ * the slot of the next wheel is cascaded down. An occupancy bitmap per wheel
+ * lets advance() jump over empty stretches, so advancing over an idle hour
+ * does not visit 3.6 million ticks.
+ *
+ * The wheel knows nothing about time, a tick is whatever the owner makes of
+ * it, which also makes it a virtual clock: advance(to) is all it takes.
+ * Timers live in a slab reused through a free list, so once the wheel has
+ * grown, adding a timer does not allocate.
+ *
+ * The wheel is not thread safe.
+ */
+template <typename T>
+class timer_wheel
+{
+public:
+    using timer_id = uint64_t; // 0 is never a valid timer
+
+    static constexpr unsigned slot_bits = 6;
+    static constexpr unsigned slots     = 1u << slot_bits;
+    static constexpr unsigned levels    = 6; // 2^36 ticks ahead, then it wraps
+
+    explicit timer_wheel(uint64_t now = 0) :
+        m_now(now)
+    {
+    }
+
+    timer_wheel(const timer_wheel&)            = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+
+    /// @brief the last tick advance() went through.
+    uint64_t now() const { return m_now; }
+    size_t   size() const { return m_size; }
+
+    /// @brief add an item due at `expiry`, and then every `period` ticks if
+    /// period is not 0. An expiry in the past is due on the next advance().
+    timer_id add(uint64_t expiry, T item, uint64_t period = 0)
+    {
+        uint32_t index;
+        if (m_free.empty())
+        {
+            index = (uint32_t)m_timers.size();
+            m_timers.emplace_back();
+        }
+        else
+        {
+            index = m_free.back();
+            m_free.pop_back();
+        }
+        timer& t   = m_timers[index];
+        t.m_index  = index;
+        t.m_item   = std::move(item);
+        t.m_period = period;
+        t.m_armed  = true;
+        m_size++;
+        schedule(t, expiry);
+        return ((timer_id)t.m_generation << 32) | (index + 1);
+    }
+
+    /// @brief returns false if the timer already fired or was cancelled.
+    bool cancel(timer_id id)
+    {
+        uint64_t index = (id & 0xffffffff) - 1;
+        if (index >= m_timers.size())
+            return false;
+        timer& t = m_timers[index];
+        if (!t.m_armed || t.m_generation != (uint32_t)(id >> 32))
+            return false;
+        unlink(t);
+        retire(t);
+        return true;
+    }
+
+    /// @brief advance to tick `to`, calling due(T) for every timer due on
+    /// the way, in expiry order. A one-shot item is moved out, a periodic one
+    /// is copied and re-armed, missed periods are skipped. due() must not
+    /// touch the wheel.
+    template <class due_fn>
+    void advance(uint64_t to, due_fn&& due)
+    {
+        m_horizon = to;
+        fire(m_expired, due);
+        while (m_now < to)
+        {
+            // only ticks where a slot fires or cascades are visited.
+            uint64_t next = next_expiry();
+            if (next > to)
+                break;
+            m_now = next;
+            if ((m_now & (slots - 1)) == 0)
+                cascade();
+            fire(m_wheels[0][m_now & (slots - 1)], due);
+            fire(m_expired, due);
+        }
+        m_now = std::max(m_now, to);
+    }
+
+    /// @brief a tick at or before the next expiry, max() when empty. advance()
+    /// to it either fires something or cascades timers closer.
+    uint64_t next_expiry() const
+    {
+        if (!m_expired.empty())
+            return m_now;
+        for (unsigned level = 0; level < levels; level++)
+        {
+            unsigned shift = level * slot_bits;
+            unsigned digit = (m_now >> shift) & (slots - 1);
+            uint64_t bits  = 0;
+            if (digit != slots - 1)
+                bits = m_occupied[level] & (~0ull << (digit + 1));
+            if (bits)
+            {
+                uint64_t block = (m_now >> (shift + slot_bits)) << (shift + slot_bits);
+                return block | ((uint64_t)std::countr_zero(bits) << shift);
+            }
+        }
+        if (m_size == 0)
+            return std::numeric_limits<uint64_t>::max();
+        // only timers a whole rotation ahead, wake up when the top wraps.
+        unsigned top = levels * slot_bits;
+        return ((m_now >> top) + 1) << top;
+    }
+
+private:
+    struct timer
+    {
+        INTRUSIVE_NS::intrusive_list_node m_node;
+        T                                 m_item{};
+        uint64_t                          m_expiry     = 0;
+        uint64_t                          m_period     = 0;
+        uint32_t                          m_index      = 0;
+        uint32_t                          m_generation = 0;
+        uint8_t                           m_level      = 0;
+        uint8_t                           m_slot       = 0;
+        bool                              m_armed      = false;
+        bool                              m_expired    = false; // in m_expired
+    };
+
+    static timer& owner(INTRUSIVE_NS::intrusive_list_node* node)
+    {
+        return *node->container(&timer::m_node);
+    }
+
+    void schedule(timer& t, uint64_t expiry)
+    {
+        t.m_expiry = expiry;
+        if (expiry <= m_now)
+        {
+            t.m_expired = true;
+            m_expired.push_back(t.m_node);
+            return;
+        }
+        // the lowest level where expiry and now share the upper digits.
+        unsigned level = 0;
+        while (level < levels - 1 && (expiry >> ((level + 1) * slot_bits)) !=
+                                         (m_now >> ((level + 1) * slot_bits)))
+        {
+            level++;
+        }
+        unsigned slot = (expiry >> (level * slot_bits)) & (slots - 1);
+        t.m_expired   = false;
+        t.m_level     = (uint8_t)level;
+        t.m_slot      = (uint8_t)slot;
+        m_wheels[level][slot].push_back(t.m_node);
+        m_occupied[level] |= 1ull << slot;
+    }
+
+    void unlink(timer& t)
+    {
+        t.m_node.earse();
+        if (!t.m_expired && m_wheels[t.m_level][t.m_slot].empty())
+            m_occupied[t.m_level] &= ~(1ull << t.m_slot);
+    }
+
+    void retire(timer& t)
+    {
+        t.m_item  = T{};
+        t.m_armed = false;
+        t.m_generation++;
+        m_free.push_back(t.m_index);
+        m_size--;
+    }
+
+    // m_now just entered a new block, bring down the slots of the wheels that
+    // wrapped around, the highest first.
+    void cascade()
+    {
+        unsigned top = 1;
+        while (top + 1 < levels && (m_now & ((1ull << (top + 1) * slot_bits) - 1)) == 0)
+        {
+            top++;
+        }
+        for (unsigned level = top; level >= 1; level--)
+        {
+            unsigned slot = (m_now >> (level * slot_bits)) & (slots - 1);
+            // timers a rotation ahead may land in the same slot again.
+            INTRUSIVE_NS::intrusive_list moving;
+            while (!m_wheels[level][slot].empty())
+            {
+                timer& t = owner(m_wheels[level][slot].front());
+                unlink(t);
+                moving.push_back(t.m_node);
+            }
+            while (!moving.empty())
+            {
+                timer& t = owner(moving.front());
+                t.m_node.earse();
+                schedule(t, t.m_expiry);
+            }
+        }
+    }
+
+    template <class due_fn>
+    void fire(INTRUSIVE_NS::intrusive_list& list, due_fn& due)
+    {
+        while (!list.empty())
+        {
+            timer& t = owner(list.front());
+            unlink(t);
+            if (t.m_period)
+            {
+                // once per advance(), the periods missed up to `to` are skipped.
+                uint64_t expiry = t.m_expiry + t.m_period;
+                if (expiry <= m_horizon)
+                    expiry += ((m_horizon - expiry) / t.m_period + 1) * t.m_period;
+                schedule(t, expiry);
+                due(T(t.m_item));
+            }
+            else
+            {
+                T item = std::move(t.m_item);
+                retire(t);
+                due(std::move(item));
+            }
+        }
+    }
+
+    uint64_t                     m_now;
+    uint64_t                     m_horizon = 0; // where advance() goes
+    size_t                       m_size = 0;
+    INTRUSIVE_NS::intrusive_list m_wheels[levels][slots];
+    uint64_t                     m_occupied[levels] = {};
+    INTRUSIVE_NS::intrusive_list m_expired; // due on the next advance()
+    std::deque<timer>            m_timers;  // stable addresses for the lists
+    std::vector<uint32_t>        m_free;
+};
+
+} // namespace EBUS_NS
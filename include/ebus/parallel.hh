@@ -0,0 +1,275 @@
+#pragma once
+
+#include "task.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/**
+ * @class parallel_job
+ *
+ * The engine behind the parallel algorithms below. A job is split in chunks,
+ * the chunks are claimed one by one through an atomic counter by the calling
+ * thread and by helper tasks on the workers of the connected @ref
+ * task_scheduler_iface, so a busy worker simply claims fewer chunks.
+ *
+ * execute() returns once every chunk is done. The calling thread always
+ * takes part in the work, hence the algorithms do complete (serially) when
+ * the workers are busy, when they are called from a worker, or when there is
+ * no scheduler at all. The job is reference counted since helper tasks may
+ * only get to run, and find nothing left, after execute() returned.
+ */
+class parallel_job : public task_base
+{
+public:
+    virtual ~parallel_job() = default;
+
+    /// @brief run the chunks with up to `helpers` helper tasks.
+    void execute(size_t helpers);
+
+    virtual void task_done() override {}
+    virtual void add_ref() override;
+    virtual void release() override;
+
+    /// @brief the number of chunks to split n items into.
+    ///
+    /// Enough chunks per thread for the dynamic claiming to even out uneven
+    /// work, but never smaller than `grain` items, 0 means no minimum.
+    static size_t chunks(size_t n, size_t grain, size_t threads);
+
+    /// @brief the first item of a chunk, chunk_begin(n, nchunks, nchunks) == n.
+    static size_t chunk_begin(size_t n, size_t nchunks, size_t chunk)
+    {
+        return n * chunk / nchunks;
+    }
+
+protected:
+    explicit parallel_job(size_t nchunks);
+    virtual void run_chunk(size_t chunk) = 0;
+
+private:
+    // claim and run chunks until none is left.
+    void work();
+
+    const size_t       m_nchunks;
+    std::atomic_size_t m_next      = 0;
+    std::atomic_size_t m_completed = 0;
+    std::atomic_size_t m_refcount  = 0;
+};
+
+template <class chunk_fn>
+class parallel_chunk_job final : public parallel_job
+{
+public:
+    parallel_chunk_job(size_t nchunks, chunk_fn& fn) :
+        parallel_job(nchunks),
+        m_fn(fn)
+    {
+    }
+
+protected:
+    // chunks only run before execute() returns, so the caller's function is
+    // still alive.
+    virtual void run_chunk(size_t chunk) override { m_fn(chunk); }
+
+    chunk_fn& m_fn;
+};
+
+/// @brief calls fn(chunk) for every chunk in [0, nchunks) on up to `threads`
+/// threads, the calling one included.
+template <class chunk_fn>
+void
+parallel_chunks(size_t nchunks, size_t threads, chunk_fn&& fn)
+{
+    if (nchunks <= 1 || threads == 0)
+    {
+        for (size_t c = 0; c < nchunks; c++)
+            fn(c);
+        return;
+    }
+    using job_t = parallel_chunk_job<std::remove_reference_t<chunk_fn>>;
+
+    INTRUSIVE_NS::intrusive_ptr<job_t> job(new job_t(nchunks, fn));
+    job->execute(std::min(nchunks - 1, threads));
+}
+
+/// @brief the number of workers of the connected task scheduler.
+size_t parallel_threads();
+
+/**
+ * @brief calls body(i) for every i in [first, last) in parallel.
+ */
+template <class body_t>
+void
+parallel_for(size_t first, size_t last, body_t&& body, size_t grain = 0)
+{
+    if (last <= first)
+        return;
+    size_t n       = last - first;
+    size_t threads = parallel_threads();
+    size_t nchunks = parallel_job::chunks(n, grain, threads);
+
+    parallel_chunks(nchunks,
+                    threads,
+                    [&](size_t c)
+                    {
+                        size_t end = first + parallel_job::chunk_begin(n, nchunks, c + 1);
+                        for (size_t i = first + parallel_job::chunk_begin(n, nchunks, c);
+                             i < end;
+                             i++)
+                        {
+                            body(i);
+                        }
+                    });
+}
+
+/**
+ * @brief reduce(... reduce(reduce(identity, map(first)), map(first + 1)) ...)
+ *
+ * reduce has to be associative, partial results are combined in order so
+ * the result is deterministic even for floating points.
+ */
+template <typename T, class map_t, class reduce_t>
+T
+parallel_reduce(size_t     first,
+                size_t     last,
+                T          identity,
+                map_t&&    map,
+                reduce_t&& reduce,
+                size_t     grain = 0)
+{
+    if (last <= first)
+        return identity;
+    size_t         n       = last - first;
+    size_t         threads = parallel_threads();
+    size_t         nchunks = parallel_job::chunks(n, grain, threads);
+    std::vector<T> partials(nchunks, identity);
+
+    parallel_chunks(nchunks,
+                    threads,
+                    [&](size_t c)
+                    {
+                        T      acc = identity;
+                        size_t end = first + parallel_job::chunk_begin(n, nchunks, c + 1);
+                        for (size_t i = first + parallel_job::chunk_begin(n, nchunks, c);
+                             i < end;
+                             i++)
+                        {
+                            acc = reduce(std::move(acc), map(i));
+                        }
+                        partials[c] = std::move(acc);
+                    });
+
+    T result = identity;
+    for (T& partial : partials)
+    {
+        result = reduce(std::move(result), std::move(partial));
+    }
+    return result;
+}
+
+/**
+ * @brief inclusive scan of [first, last) into out, starting from init, like
+ * std::inclusive_scan(first, last, out, op, init). Returns the end of out.
+ *
+ * Two passes, each chunk is summed in parallel, the chunk offsets are
+ * accumulated serially, then each chunk is scanned in parallel.
+ */
+template <class input_t, class output_t, typename T, class op_t = std::plus<>>
+output_t
+parallel_scan(input_t  first,
+              input_t  last,
+              output_t out,
+              T        init,
+              op_t     op    = {},
+              size_t   grain = 0)
+{
+    size_t n = (size_t)std::distance(first, last);
+    if (n == 0)
+        return out;
+    size_t         threads = parallel_threads();
+    size_t         nchunks = parallel_job::chunks(n, grain, threads);
+    std::vector<T> offsets(nchunks, init);
+
+    // pass 1, the sum of each chunk but the last.
+    parallel_chunks(nchunks - 1,
+                    threads,
+                    [&](size_t c)
+                    {
+                        size_t begin = parallel_job::chunk_begin(n, nchunks, c);
+                        size_t end   = parallel_job::chunk_begin(n, nchunks, c + 1);
+                        T      acc   = first[begin];
+                        for (size_t i = begin + 1; i < end; i++)
+                        {
+                            acc = op(std::move(acc), first[i]);
+                        }
+                        offsets[c + 1] = std::move(acc);
+                    });
+    for (size_t c = 1; c < nchunks; c++)
+    {
+        offsets[c] = op(offsets[c - 1], std::move(offsets[c]));
+    }
+    // pass 2
+    parallel_chunks(nchunks,
+                    threads,
+                    [&](size_t c)
+                    {
+                        size_t begin = parallel_job::chunk_begin(n, nchunks, c);
+                        size_t end   = parallel_job::chunk_begin(n, nchunks, c + 1);
+                        T      acc   = offsets[c];
+                        for (size_t i = begin; i < end; i++)
+                        {
+                            acc    = op(std::move(acc), first[i]);
+                            out[i] = acc;
+                        }
+                    });
+    return out + n;
+}
+
+/**
+ * @brief sorts [first, last), chunks are sorted in parallel then merged
+ * pairwise in parallel rounds. Not stable.
+ */
+template <class iterator_t, class compare_t = std::less<>>
+void
+parallel_sort(iterator_t first, iterator_t last, compare_t comp = {}, size_t grain = 1024)
+{
+    size_t n       = (size_t)std::distance(first, last);
+    size_t threads = parallel_threads();
+    size_t nchunks = parallel_job::chunks(n, grain, threads);
+    if (nchunks <= 1)
+    {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    auto bound = [n, nchunks](size_t chunk)
+    { return parallel_job::chunk_begin(n, nchunks, std::min(chunk, nchunks)); };
+
+    parallel_chunks(nchunks,
+                    threads,
+                    [&](size_t c) { std::sort(first + bound(c), first + bound(c + 1), comp); });
+    for (size_t width = 1; width < nchunks; width *= 2)
+    {
+        size_t npairs = (nchunks + 2 * width - 1) / (2 * width);
+        parallel_chunks(npairs,
+                        threads,
+                        [&](size_t p)
+                        {
+                            size_t lo = p * 2 * width;
+                            std::inplace_merge(first + bound(lo),
+                                               first + bound(lo + width),
+                                               first + bound(lo + 2 * width),
+                                               comp);
+                        });
+    }
+}
+
+} // namespace EBUS_NS
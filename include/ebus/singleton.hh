@@ -1,6 +1,8 @@
 #pragma once
 #include "export.hh"
 
+#include <atomic>
+
 namespace EBUS_NS
 {
 
@@ -23,4 +25,39 @@ protected:
     singleton& operator=(const singleton&) = delete;
 };
 
+/**
+ * @class singleton_ref
+ *
+ * A direct pointer to singleton<T>::get_instance(), for the hot paths. Once
+ * set, get() is a single load of a constant initialized pointer, no guard of
+ * a function local static and no call into the library exporting the
+ * singleton. The pointer is per module on Windows and shared on Linux,
+ * either way it points to the one instance, so exporting the singleton with
+ * EBUS_HANDLER_DECLARE/DEFINE works as before.
+ */
+template <typename T>
+class singleton_ref
+{
+public:
+    static T& get()
+    {
+        T* instance = s_instance.load(std::memory_order_acquire);
+        if (instance) [[likely]]
+            return *instance;
+        return init();
+    }
+
+    /// @brief constructs the singleton now, at startup for instance, rather
+    /// than on the first get().
+    static T& init()
+    {
+        T& instance = singleton<T>::get_instance();
+        s_instance.store(&instance, std::memory_order_release);
+        return instance;
+    }
+
+private:
+    static inline constinit std::atomic<T*> s_instance = nullptr;
+};
+
 } // namespace EBUS_NS
@@ -1,15 +1,33 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <deque>
 #include <functional>
+#include <type_traits>
 
+#include <ebus/memory/block_pool.hh>
 #include <ebus/memory/intrusive_ptr.hh>
+#include <ebus/memory/ref_counted.hh>
+#include <ebus/cancel_token.hh>
 
 #include <ebus/ebus.hh>
 
 namespace EBUS_NS
 {
 
+/// urgency classes of tasks, workers drain the more urgent ones first.
+enum class task_priority : uint8_t
+{
+    critical   = 0,
+    normal     = 1,
+    background = 2,
+    count,
+};
+
+using task_clock = std::chrono::steady_clock;
+
 /**
  * @class task
  *
@@ -25,6 +43,18 @@ namespace EBUS_NS
  * management for task since a task is an @ref intrusive_ptr in @ref
  * task_worker. This can be a good thing because often you do not need to
  * implement any memory management at all.
+ *
+ * @section priority
+ *
+ * @ref m_priority and @ref m_deadline can be set directly or through the
+ * tagging task_scheduler_iface::add_task() overload. Within a priority, tasks
+ * with the earliest deadline run first, tasks without deadline come last in
+ * submission order.
+ *
+ * @section cancellation
+ *
+ * A task carrying a cancelled @ref m_cancel token is not executed, the
+ * worker calls @ref task_cancelled instead of exec() and task_done().
  */
 struct task_base
 {
@@ -41,6 +71,22 @@ struct task_base
 
     // this should defines a done event for the task, the subclass
     virtual void task_done() = 0;
+    // the task was cancelled before it could run.
+    virtual void task_cancelled() {}
+
+    bool cancelled() const { return m_cancel.cancelled(); }
+
+    /// @brief what the workers do with a task.
+    void run()
+    {
+        if (cancelled())
+        {
+            task_cancelled();
+            return;
+        }
+        exec();
+        task_done();
+    }
 
     //////////////////////////////////////////////////////////////////////////
     // for intrusive_ptr support
@@ -48,7 +94,75 @@ struct task_base
     virtual void release() = 0; // a default impl is delete if <= 0
     //////////////////////////////////////////////////////////////////////////
 
-    exec_fn m_function; // return true if success.
+    exec_fn                m_function; // return true if success.
+    task_priority          m_priority = task_priority::normal;
+    task_clock::time_point m_deadline = task_clock::time_point::max(); // none
+    cancel_token           m_cancel;
+    // when the task was queued, in task_clock ticks. Only stamped by workers
+    // collecting metrics, atomic as a periodic task may be queued again
+    // while running.
+    std::atomic<task_clock::rep> m_queued = 0;
+};
+
+/**
+ * @class pooled_task
+ *
+ * A task storing its callable inline, allocated from a @ref block_pool. The
+ * @ref m_function only captures the task itself, it fits in the small buffer
+ * of std::function, so creating, submitting and releasing a pooled_task does
+ * no heap allocation once the pool is warm. Use @ref make_task to create
+ * one.
+ *
+ * The callable returns either bool, like @ref task_base::exec_fn, or void,
+ * which counts as success.
+ */
+template <class fn_t>
+class pooled_task final : public task_base, public ref_counted<pooled_task<fn_t>>
+{
+    using counted_t = ref_counted<pooled_task<fn_t>>;
+
+public:
+    template <class arg_t>
+    explicit pooled_task(arg_t&& fn) :
+        m_fn(std::forward<arg_t>(fn))
+    {
+        m_function = [this]() { return invoke(); };
+    }
+
+    virtual void task_done() override {}
+    virtual void add_ref() override { counted_t::add_ref(); }
+    virtual void release() override { counted_t::release(); }
+
+    static void* operator new(size_t)
+    {
+        return block_pool<sizeof(pooled_task)>::allocate();
+    }
+    static void operator delete(void* p)
+    {
+        block_pool<sizeof(pooled_task)>::deallocate(p);
+    }
+
+private:
+    bool invoke()
+    {
+        if constexpr (std::is_void_v<std::invoke_result_t<fn_t&>>)
+        {
+            m_fn();
+            return true;
+        }
+        else
+            return m_fn();
+    }
+
+    fn_t m_fn;
 };
 
+/// @brief creates a @ref pooled_task running fn.
+template <class fn_t>
+task_base::ptr
+make_task(fn_t&& fn)
+{
+    return task_base::ptr(new pooled_task<std::decay_t<fn_t>>(std::forward<fn_t>(fn)));
+}
+
 } // namespace EBUS_NS
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "task_scheduler.hh"
+
+#include <array>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace EBUS_NS
+{
+
+namespace chain_detail
+{
+
+template <class... types>
+struct type_list
+{
+};
+
+// the result of a step given the result of the previous one.
+template <class prev_t, class fn_t>
+struct step_result
+{
+    using type = std::invoke_result_t<fn_t&, prev_t&&>;
+};
+
+template <class fn_t>
+struct step_result<void, fn_t>
+{
+    using type = std::invoke_result_t<fn_t&>;
+};
+
+// the results of all the steps, in order.
+template <class prev_t, class list_t, class... fns>
+struct results;
+
+template <class prev_t, class... done>
+struct results<prev_t, type_list<done...>>
+{
+    using type = type_list<done...>;
+};
+
+template <class prev_t, class... done, class fn_t, class... rest>
+struct results<prev_t, type_list<done...>, fn_t, rest...>
+{
+    using result = typename step_result<prev_t, fn_t>::type;
+    using type   = typename results<result, type_list<done..., result>, rest...>::type;
+};
+
+template <class T>
+using stored_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+// alternative 0 is the empty chain, alternative i + 1 the result of step i.
+template <class list_t>
+struct storage;
+
+template <class... types>
+struct storage<type_list<types...>>
+{
+    using type = std::variant<std::monostate, stored_t<types>...>;
+};
+
+} // namespace chain_detail
+
+/**
+ * @class chain_task
+ *
+ * The task behind a @ref task_chain. It holds every step and a single
+ * variant for the result in flight: step i moves the result of step i - 1 out
+ * and leaves its own. Once a step is done the same task is added again for
+ * the next step, so a chain is one pooled allocation whatever its length.
+ */
+template <class... fns>
+class chain_task final : public task_base, public ref_counted<chain_task<fns...>>
+{
+    using counted_t = ref_counted<chain_task<fns...>>;
+    using results_t =
+        typename chain_detail::results<void, chain_detail::type_list<>, fns...>::type;
+    using storage_t = typename chain_detail::storage<results_t>::type;
+
+public:
+    static constexpr size_t steps = sizeof...(fns);
+
+    explicit chain_task(std::tuple<fns...>&& steps_fns) :
+        m_fns(std::move(steps_fns))
+    {
+        m_function = [this]() { return run_step(); };
+    }
+
+    // the next step, unless the chain was cancelled meanwhile.
+    virtual void task_done() override
+    {
+        if (++m_step < steps && !cancelled())
+            task_scheduler_iface::add_task(task_base::ptr(this));
+    }
+    virtual void add_ref() override { counted_t::add_ref(); }
+    virtual void release() override { counted_t::release(); }
+
+    static void* operator new(size_t)
+    {
+        return block_pool<sizeof(chain_task)>::allocate();
+    }
+    static void operator delete(void* p)
+    {
+        block_pool<sizeof(chain_task)>::deallocate(p);
+    }
+
+private:
+    bool run_step()
+    {
+        return dispatch(std::make_index_sequence<steps>());
+    }
+
+    template <size_t... I>
+    bool dispatch(std::index_sequence<I...>)
+    {
+        using step_fn = void (chain_task::*)();
+        static constexpr std::array<step_fn, steps> table = {&chain_task::step<I>...};
+        (this->*table[m_step])();
+        return true;
+    }
+
+    template <size_t I>
+    void step()
+    {
+        auto& fn = std::get<I>(m_fns);
+        if constexpr (I == 0)
+        {
+            emplace<I>([&fn]() { return fn(); });
+        }
+        else
+        {
+            // the result of step I - 1, monostate when it returned void.
+            using prev_t = std::variant_alternative_t<I, storage_t>;
+            if constexpr (std::is_same_v<prev_t, std::monostate>)
+            {
+                emplace<I>([&fn]() { return fn(); });
+            }
+            else
+            {
+                // moved out before the variant takes the new result.
+                prev_t prev = std::move(std::get<I>(m_storage));
+                emplace<I>([&fn, &prev]() { return fn(std::move(prev)); });
+            }
+        }
+    }
+
+    template <size_t I, class call_t>
+    void emplace(call_t&& call)
+    {
+        if constexpr (std::is_void_v<decltype(call())>)
+        {
+            call();
+            m_storage.template emplace<I + 1>();
+        }
+        else
+        {
+            m_storage.template emplace<I + 1>(call());
+        }
+    }
+
+    std::tuple<fns...> m_fns;
+    storage_t          m_storage;
+    size_t             m_step = 0;
+};
+
+/**
+ * @class task_chain
+ *
+ * Typed continuations: each step takes the result of the previous one by
+ * value, moved straight from the storage inside the chain, no shared_ptr
+ * around the lambdas and no allocation per step.
+ *
+ * Usage Example:
+ * @code
+ * make_chain([path]() { return load(path); })
+ *     .then([](std::vector<char> bytes) { return parse(std::move(bytes)); })
+ *     .then([](document doc) { publish(std::move(doc)); })
+ *     .submit();
+ * @endcode
+ *
+ * A step returning void hands nothing to the next one. Every step runs as
+ * its own task, with the priority and the @ref cancel_token of the chain;
+ * once cancelled the remaining steps never run.
+ */
+template <class... fns>
+class task_chain
+{
+public:
+    explicit task_chain(std::tuple<fns...>&& steps) :
+        m_fns(std::move(steps))
+    {
+    }
+
+    template <class fn_t>
+    task_chain<fns..., std::decay_t<fn_t>> then(fn_t&& fn) &&
+    {
+        return task_chain<fns..., std::decay_t<fn_t>>(
+            std::tuple_cat(std::move(m_fns), std::make_tuple(std::forward<fn_t>(fn))));
+    }
+
+    /// @brief the chain as a task, to tag it before adding it.
+    task_base::ptr task() &&
+    {
+        return task_base::ptr(new chain_task<fns...>(std::move(m_fns)));
+    }
+
+    /// @brief adds the first step to the task scheduler.
+    void submit() && { task_scheduler_iface::add_task(std::move(*this).task()); }
+
+private:
+    std::tuple<fns...> m_fns;
+};
+
+/// @brief starts a @ref task_chain with its first step.
+template <class fn_t>
+task_chain<std::decay_t<fn_t>>
+make_chain(fn_t&& fn)
+{
+    return task_chain<std::decay_t<fn_t>>(std::make_tuple(std::forward<fn_t>(fn)));
+}
+
+} // namespace EBUS_NS
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "task.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/**
+ * @class task_graph
+ *
+ * A directed acyclic graph of tasks. Nodes may have any number of
+ * predecessors and successors, a node is handed to the workers of the
+ * connected @ref task_scheduler_iface as soon as all its predecessors are
+ * done. Tracking is done with an atomic predecessor counter per node.
+ *
+ * The graph is built once and can be run again and again, a run does not
+ * allocate anything, it only resets the counters.
+ *
+ * Usage Example:
+ * @code
+ * task_graph graph;
+ * auto physics   = graph.add_node([]() { return step_physics(); });
+ * auto animation = graph.add_node([]() { return step_animation(); });
+ * auto render    = graph.add_node([]() { return render_frame(); });
+ * graph.precede(physics, render);
+ * graph.precede(animation, render);
+ *
+ * while (running)
+ *     graph.run_and_wait();
+ * @endcode
+ *
+ * The graph has to outlive its runs, and a task scheduler has to be
+ * connected, otherwise the nodes never run.
+ */
+class task_graph
+{
+public:
+    using node_id = uint32_t;
+
+    task_graph() = default;
+    ~task_graph();
+
+    task_graph(const task_graph&)            = delete;
+    task_graph& operator=(const task_graph&) = delete;
+
+    node_id add_node(const task_base::exec_fn& fn,
+                     task_priority             priority = task_priority::normal);
+    /// @brief `after` runs only once `before` is done.
+    void precede(node_id before, node_id after);
+
+    /// @brief schedules the nodes without predecessors and returns.
+    void run();
+    /// @brief blocks until every node of the current run is done.
+    void wait();
+    void run_and_wait()
+    {
+        run();
+        wait();
+    }
+
+    size_t size() const { return m_nodes.size(); }
+    bool   running();
+
+private:
+    struct node final : task_base
+    {
+        node(task_graph& graph, node_id id, const exec_fn& fn);
+
+        // the graph owns the nodes, the count only tells when the workers
+        // are done with a node, which is after task_done().
+        virtual void add_ref() override;
+        virtual void release() override;
+        virtual void task_done() override;
+        // the successors still run, they may carry the token too.
+        virtual void task_cancelled() override { task_done(); }
+
+        task_graph&                 m_graph;
+        const node_id               m_id;
+        std::vector<node_id>        m_successors;
+        uint32_t                    m_predecessors = 0;
+        std::atomic<uint32_t>       m_pending      = 0;
+        std::atomic<uint32_t>       m_refcount     = 0;
+        std::vector<task_base::ptr> m_ready; // sized once, reused every run
+    };
+
+    // refresh the root list and check for cycles if the graph changed.
+    void prepare();
+    void node_done(node& done);
+    void node_released();
+
+    std::vector<std::unique_ptr<node>> m_nodes;
+    std::vector<node_id>               m_roots;
+    std::vector<task_base::ptr>        m_ready_roots;
+    bool                               m_dirty = true;
+
+    std::atomic<uint32_t>   m_remaining = 0;
+    std::mutex              m_lock;
+    std::condition_variable m_cv;
+    bool                    m_done = true; // protected by m_lock
+};
+
+} // namespace EBUS_NS
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <ebus/ebus.hh>
+
+#include "task.hh"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/**
+ * @struct task_histogram
+ *
+ * Durations in power of two buckets of nanoseconds, bucket i counts the
+ * durations of at least 2^(i - 1) ns and below 2^i ns, the last one
+ * everything longer. A percentile is the upper bound of its bucket, so it is
+ * known within a factor of two.
+ */
+struct task_histogram
+{
+    static constexpr size_t buckets = 40; // the last one starts at 9 minutes
+
+    std::array<uint64_t, buckets> counts{};
+    uint64_t                      count = 0;
+    task_clock::duration          total{0};
+
+    static size_t bucket(task_clock::duration d);
+
+    void add(task_clock::duration d);
+    void merge(const task_histogram& other);
+
+    task_clock::duration mean() const;
+    /// @brief q in [0, 1], 0 without samples.
+    task_clock::duration percentile(double q) const;
+};
+
+/**
+ * @class task_histogram_recorder
+ *
+ * A @ref task_histogram written by a single thread and read by any. The
+ * writer only does relaxed loads and stores, no read-modify-write, so it
+ * costs about the same as a plain histogram. A snapshot may miss the sample
+ * being recorded.
+ */
+class task_histogram_recorder
+{
+public:
+    void record(task_clock::duration d)
+    {
+        bump(m_counts[task_histogram::bucket(d)], 1);
+        bump(m_count, 1);
+        bump(m_total, (uint64_t)d.count());
+    }
+
+    task_histogram snapshot() const;
+
+private:
+    static void bump(std::atomic<uint64_t>& value, uint64_t by)
+    {
+        value.store(value.load(std::memory_order_relaxed) + by,
+                    std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, task_histogram::buckets> m_counts{};
+    std::atomic<uint64_t>                                      m_count = 0;
+    std::atomic<uint64_t>                                      m_total = 0;
+};
+
+/// the metrics of a single worker.
+struct task_worker_metrics
+{
+    size_t               queue_depth = 0;
+    uint64_t             executed    = 0;
+    task_histogram       wait; // from being queued to running
+    task_histogram       run;
+    task_clock::duration busy{0};
+    task_clock::duration idle{0}; // since the worker was built
+};
+
+/**
+ * @struct task_scheduler_metrics
+ *
+ * A snapshot of every worker of a scheduler, with the totals.
+ */
+struct task_scheduler_metrics
+{
+    std::vector<task_worker_metrics> workers;
+
+    size_t               queue_depth() const;
+    uint64_t             executed() const;
+    task_histogram       wait() const;
+    task_histogram       run() const;
+    task_clock::duration busy() const;
+    task_clock::duration idle() const;
+
+    /// @brief the busy time of the busiest worker over the mean one, 1 when
+    /// the work is even, the number of workers when one does everything, 0
+    /// without work.
+    double imbalance() const;
+};
+
+/**
+ * @class task_metrics_iface
+ *
+ * Snapshots of the scheduler metrics, for any subsystem to query. A
+ * default_task_scheduler answers when task_scheduler_config::metrics is set.
+ *
+ * Usage Example:
+ * @code
+ * task_scheduler_metrics metrics = task_metrics_iface::snapshot();
+ * log("p99 wait {}us, imbalance {}",
+ *     duration_cast<microseconds>(metrics.wait().percentile(0.99)).count(),
+ *     metrics.imbalance());
+ * @endcode
+ */
+struct task_metrics_iface : public ebus_iface<ebus_type::GLOBAL>
+{
+    /// @brief empty without a scheduler collecting metrics.
+    static task_scheduler_metrics  snapshot();
+    virtual task_scheduler_metrics m_snapshot() = 0;
+};
+
+using task_metrics_bus = ebus<task_metrics_iface>;
+
+/**
+ * @class task_metrics_report_iface
+ *
+ * Receives the periodic reports, see
+ * task_scheduler_config::metrics_period. Called on a worker.
+ */
+struct task_metrics_report_iface : public ebus_iface<ebus_type::GLOBAL>
+{
+    virtual void m_report(const task_scheduler_metrics& metrics) = 0;
+};
+
+using task_metrics_report_bus = ebus<task_metrics_report_iface>;
+
+} // namespace EBUS_NS
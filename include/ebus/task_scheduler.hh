@@ -2,32 +2,68 @@
 
 #include <ebus/ebus.hh>
 
+#include "hash.hh"
 #include "task.hh"
+#include "task_metrics.hh"
+#include "task_worker.hh"
+#include "memory/timer_wheel.hh"
 
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 namespace EBUS_NS
 {
 
+/**
+ * @class rescheduable_task
+ *
+ * A chain of steps built by the thread which created it, then submitted by
+ * finish(). The steps share data through their captures, see @ref task_chain
+ * for steps passing their results to each other.
+ *
+ * A step added by reschedule() runs right after the previous one on the same
+ * worker, without going back to the scheduler. A step added by hand_off()
+ * is added to the scheduler instead, and may run on another worker, so a
+ * long chain lets other tasks in or spreads its work.
+ */
 struct rescheduable_task : task_base
 {
     using ptr     = INTRUSIVE_NS::intrusive_ptr<rescheduable_task>;
     using fini_fn = std::function<void(void)>;
 
-    /// API to support task rescheduling
+    /// @brief appends a step running inline after the previous one, returns
+    /// the chain.
     virtual ptr reschedule(task_base::exec_fn&& exec) = 0;
-    // API to mark the task has no following task need to execute
+    /// @brief appends a step going through the scheduler, returns the chain.
+    /// The default is reschedule(), for the chains which do not run steps
+    /// inline.
+    virtual ptr hand_off(task_base::exec_fn&& exec)
+    {
+        return reschedule(std::move(exec));
+    }
 
-    // TODO How do I get the output from previous task? Or we don't. The users simply
-    // rely on the capture context for data sharing. I don't need type casting
-    // in that case
+    /// @brief submits the chain, fini runs after its last step.
     virtual void finish(fini_fn&& fini) = 0;
 
     fini_fn m_fini_task;
 };
 
-class task_worker;
+
+/// names a thread tasks can be sent to, see @ref affinity_queue.
+using affinity_tag = size_t;
+
+/// @brief the tag of a name, FNV-1a so it is known at compile time.
+constexpr affinity_tag
+affinity_tag_of(std::string_view name)
+{
+    return (affinity_tag)fnv1a(name);
+}
 
 /**
  * @class task_scheduler
@@ -41,41 +77,247 @@ struct task_scheduler_iface : public ebus_iface<ebus_type::GLOBAL>
     ///
     /// user is responsible to prepare the task's implementation. The task is
     /// expected to be scheduled immediately. Static function is provided here
-    /// for ease of use.
+    /// for ease of use. The task is moved to the scheduler, pass it with
+    /// std::move() and it costs no reference counting.
     static void  add_task(task_base::ptr);
     virtual void m_add_task(task_base::ptr task) = 0;
 
+    /// @brief adding a single task tagged with a priority and optionally a
+    /// deadline, no need to subclass the task for it.
+    static void add_task(task_base::ptr         task,
+                         task_priority          priority,
+                         task_clock::time_point deadline = task_clock::time_point::max());
+
+    /// @brief adding a task to the @ref affinity_queue with this tag, it runs
+    /// on the thread pumping that queue. Returns false if there is no such
+    /// queue.
+    static bool add_task(affinity_tag tag, task_base::ptr task);
+
+    /// @brief adding a batch of tasks
+    ///
+    /// The tasks are moved out of the span. Costs a single bus broadcast, the
+    /// default implementation simply adds the tasks one by one.
+    static void  add_tasks(std::span<task_base::ptr> tasks);
+    virtual void m_add_tasks(std::span<task_base::ptr> tasks);
+
+    /// @brief number of threads executing the tasks, 0 if there is no
+    /// scheduler. Used to decide how much to split work.
+    static size_t  concurrency();
+    virtual size_t m_concurrency() { return 1; }
+
     /// @brief Adding a reschedule-able task.
     ///
     /// The implementation should wait for rescheduable_task::done() to
     /// actually adding the task to the system, for the thread safety. Static
     /// function is provided here for ease of use.
     static rescheduable_task::ptr add_rescheduable_task(const task_base::exec_fn&);
+    /// @brief the same, every step of the chain carries the token.
+    static rescheduable_task::ptr add_rescheduable_task(const task_base::exec_fn& fn,
+                                                        const cancel_token&       token);
     virtual rescheduable_task::ptr
     m_add_rescheduable_task(const task_base::exec_fn&) = 0;
+
+    /// @brief timers, a task is added to the workers once due. 0 is returned
+    /// when there is no scheduler.
+    using timer_id = uint64_t;
+    static timer_id add_task_after(task_clock::duration delay, task_base::ptr task);
+    static timer_id add_task_at(task_clock::time_point when, task_base::ptr task);
+    /// @brief the task is added every period, starting one period from now,
+    /// until the timer is cancelled. A run taking longer than the period may
+    /// overlap with the next one.
+    static timer_id add_periodic_task(task_clock::duration period, task_base::ptr task);
+    /// @brief returns false if the timer already fired or does not exist.
+    static bool cancel_timer(timer_id id);
+    /// @brief the clock of the timers, which may be virtual, see
+    /// task_scheduler_config::virtual_clock.
+    static task_clock::time_point now();
+
+    /// the defaults are for the handlers without timers.
+    virtual timer_id m_add_timer(task_clock::time_point /*when*/,
+                                 task_clock::duration /*period*/,
+                                 task_base::ptr /*task*/)
+    {
+        return 0;
+    }
+    virtual bool                   m_cancel_timer(timer_id /*id*/) { return false; }
+    virtual task_clock::time_point m_now() { return task_clock::now(); }
 };
 
 using task_scheduler_bus = ebus<task_scheduler_iface>;
 
+/**
+ * @struct task_shutdown_options
+ *
+ * How a @ref default_task_scheduler shuts down: the timers are dropped, then
+ * every worker drains its own queue in parallel, running the queued tasks
+ * until the timeout and discarding the rest by policy.
+ */
+struct task_shutdown_options
+{
+    /// from the start of the shutdown, max() to run every queued task.
+    task_clock::duration timeout = task_clock::duration::max();
+    shutdown_policy      policy  = shutdown_policy::cancel;
+};
+
+/// how a @ref default_task_scheduler picks the worker of a new task. Every
+/// policy reads the lock-free basic_task_worker::depth() counters, none
+/// touches the queues of the workers it does not pick.
+enum class task_placement : uint8_t
+{
+    /// the worker with the fewest queued tasks, reading every counter.
+    least_loaded,
+    /// the less loaded of two random workers, constant time and nearly as
+    /// even as least_loaded.
+    power_of_two,
+    /// every worker in turn, with a cursor per submitting thread.
+    round_robin,
+    /// a worker adds to its own queue, where the data its task just produced
+    /// is still in cache, at the price of the balance. Other threads use
+    /// power_of_two.
+    submitter_local,
+};
+
+/**
+ * @struct task_scheduler_config
+ *
+ * The worker topology of a @ref default_task_scheduler.
+ *
+ * Usage Example:
+ * @code
+ * task_scheduler_config latency;
+ * latency.worker_count = 2;
+ * latency.cpu_sets     = {{2}, {3}};
+ * latency.thread_name  = "latency";
+ * default_task_scheduler latency_pool(latency);
+ *
+ * // a bulk pool on the side, used directly instead of through the bus.
+ * task_scheduler_config bulk;
+ * bulk.thread_name = "bulk";
+ * bulk.connect     = false;
+ * default_task_scheduler bulk_pool(bulk);
+ * bulk_pool.m_add_task(task);
+ * @endcode
+ */
+struct task_scheduler_config
+{
+    /// number of workers, 0 picks max(2, hardware threads).
+    size_t worker_count = 0;
+    /// worker i is pinned to cpu_sets[i % cpu_sets.size()], no sets leaves
+    /// the workers unpinned.
+    std::vector<std::vector<unsigned>> cpu_sets = {};
+    /// the workers are named "<thread_name>-<index>", empty leaves them
+    /// unnamed.
+    std::string thread_name = "ebus-worker";
+    /// tasks go to the workers of the submitter's NUMA node first. Without
+    /// cpu_sets the workers are spread over the nodes.
+    bool numa_aware = false;
+    /// tasks each priority lane of a worker makes room for up front, from the
+    /// worker thread once pinned, so that much queue memory is local to its
+    /// NUMA node. Lanes growing past it reallocate on the submitting thread.
+    size_t queue_reserve = 256;
+    /// connect to the @ref task_scheduler_bus. The bus broadcasts to every
+    /// scheduler, so only one of them should be connected.
+    bool connect = true;
+    /// the tick of the timer wheel, timers never fire early but may fire up
+    /// to a tick late.
+    task_clock::duration timer_resolution = std::chrono::milliseconds(1);
+    /// the timers follow a virtual clock only moved by
+    /// default_task_scheduler::advance_clock(), for deterministic tests and
+    /// benchmarks. There is no timer thread then.
+    bool virtual_clock = false;
+    /// the workers collect the metrics answered on the @ref task_metrics_bus,
+    /// a couple of clock reads per task.
+    bool metrics = false;
+    /// with metrics, a snapshot is broadcast on the @ref
+    /// task_metrics_report_bus every period, zero for none.
+    task_clock::duration metrics_period = task_clock::duration::zero();
+    /// used by the destructor unless shutdown() was called before.
+    task_shutdown_options shutdown = {};
+    /// the worker of every task, see @ref task_placement. Batches from
+    /// add_tasks() fill the least loaded workers up to the same level
+    /// instead, except from a worker with submitter_local.
+    task_placement placement = task_placement::power_of_two;
+};
+
 /**
  * @class default_task_scheduler
  *
- * default task_scheduler implementation
+ * default task_scheduler implementation, its workers drain the tasks by
+ * @ref task_priority and deadline, see @ref priority_task_worker. The
+ * workers are set up by a @ref task_scheduler_config.
  */
-class default_task_scheduler : public ebus_handler<task_scheduler_iface>
+class default_task_scheduler : public ebus_handler<task_scheduler_iface>,
+                               public ebus_handler<task_metrics_iface>
 {
-    using handler_t = ebus_handler<task_scheduler_iface>;
+    using handler_t         = ebus_handler<task_scheduler_iface>;
+    using metrics_handler_t = ebus_handler<task_metrics_iface>;
 
 public:
     void                   m_add_task(task_base::ptr task) override;
+    void                   m_add_tasks(std::span<task_base::ptr> tasks) override;
+    size_t                 m_concurrency() override { return m_workers.size(); }
     rescheduable_task::ptr m_add_rescheduable_task(const task_base::exec_fn&) override;
+    timer_id               m_add_timer(task_clock::time_point when,
+                                       task_clock::duration   period,
+                                       task_base::ptr         task) override;
+    bool                   m_cancel_timer(timer_id id) override;
+    task_clock::time_point m_now() override;
+    task_scheduler_metrics m_snapshot() override;
 
-    default_task_scheduler();
+    explicit default_task_scheduler(const task_scheduler_config& config = {});
     ~default_task_scheduler();
 
+    /// @brief moves the virtual clock forward and adds the tasks due on the
+    /// way, see task_scheduler_config::virtual_clock.
+    void advance_clock(task_clock::duration by);
+
+    /// @brief stops the scheduler and waits for the workers, see @ref
+    /// task_shutdown_options. Tasks added meanwhile run or are discarded on
+    /// the adding thread. Only the first call shuts down, later ones return
+    /// the same report.
+    const task_shutdown_report& shutdown(const task_shutdown_options& options);
+    const task_shutdown_report& shutdown() { return shutdown(m_shutdown); }
+
 private:
-    std::vector<std::unique_ptr<task_worker>> m_workers;
-    std::vector<std::thread>                  m_worker_threads;
+    // the workers to place on, those of the submitter's NUMA node when
+    // there are some.
+    const std::vector<size_t>& candidates() const;
+    size_t                     place(const std::vector<size_t>& workers) const;
+    // a task no worker takes anymore, run or discarded on the calling thread.
+    void retire(task_base::ptr& task);
+
+    // the timer thread, sleeps until the next expiry or a sooner timer.
+    void     timer_loop();
+    uint64_t to_tick(task_clock::time_point when) const;
+
+    std::vector<std::unique_ptr<priority_task_worker>> m_workers;
+    std::vector<size_t>                                m_all_workers;
+    std::vector<std::vector<size_t>>                   m_node_workers;
+    std::vector<std::thread>                           m_worker_threads;
+    bool                                               m_numa_aware = false;
+    bool                                               m_connected  = false;
+    bool                                               m_metrics    = false;
+    task_placement                                     m_placement;
+
+    task_shutdown_options  m_shutdown;
+    std::atomic_bool       m_stopping = false;
+    std::mutex             m_report_lock; // for tasks retired by other threads
+    task_clock::time_point m_stop_deadline = task_clock::time_point::max();
+    task_shutdown_report   m_report;
+    bool                   m_stopped = false;
+
+    // one wheel and at most one thread for all the timers.
+    timer_wheel<task_base::ptr> m_timers;
+    std::mutex                  m_timer_lock;
+    std::condition_variable     m_timer_cv;
+    std::thread                 m_timer_thread;
+    std::string                 m_timer_thread_name;
+    task_clock::time_point      m_epoch;
+    task_clock::duration        m_resolution;
+    task_clock::duration        m_virtual_now{0};
+    uint64_t                    m_timer_wake    = 0; // the timer thread sleeps until
+    bool                        m_virtual_clock = false;
+    bool                        m_timer_stop    = false;
 };
 
 } // namespace EBUS_NS
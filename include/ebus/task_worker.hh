@@ -1,30 +1,229 @@
 #pragma once
 
 #include "task.hh"
+#include "task_metrics.hh"
 #include "ebus/memory/safe_queue.hh"
+#include "ebus/memory/mpmc_queue.hh"
+#include "ebus/memory/blocking_queue.hh"
+#include "ebus/memory/lane_container.hh"
 
+#include <array>
 #include <atomic>
+#include <span>
 
 namespace EBUS_NS
 {
 
 /**
- * @class task_worker
+ * @struct idle_strategy
+ *
+ * What a worker does when its queue runs dry. It first retries @ref
+ * spin_count times with a cpu pause in between, then @ref yield_count times
+ * yielding its time slice, then parks in the queue's blocking pop(). Spinning
+ * trades some cpu time for not paying a futex wake up and the wake up latency
+ * on bursty submission.
  */
-class task_worker
+struct idle_strategy
+{
+    unsigned spin_count  = 256;
+    unsigned yield_count = 16;
+
+    /// park as soon as the queue is empty.
+    static constexpr idle_strategy park() { return {0, 0}; }
+    static constexpr idle_strategy spin_then_park(unsigned spins  = 256,
+                                                  unsigned yields = 16)
+    {
+        return {spins, yields};
+    }
+};
+
+/**
+ * @struct task_worker_stats
+ *
+ * executed tasks versus times the worker had to park, and the wake ups
+ * producers had to issue. Before idle strategies every push woke the worker,
+ * so `executed - wakeups` is roughly the number of wake ups saved.
+ */
+struct task_worker_stats
+{
+    size_t executed = 0;
+    size_t parks    = 0;
+    size_t wakeups  = 0;
+};
+
+/// what happens to the tasks still queued once a shutdown deadline passed.
+enum class shutdown_policy : uint8_t
+{
+    drop,   // released without notice
+    cancel, // task_cancelled() is called, like for a cancelled token
+};
+
+/**
+ * @struct task_shutdown_report
+ *
+ * What became of the tasks queued when a shutdown started.
+ */
+struct task_shutdown_report
+{
+    size_t ran       = 0; // before the deadline
+    size_t cancelled = 0;
+    size_t dropped   = 0;
+    size_t timers    = 0; // pending timers, always dropped
+    /// the cancelled and dropped tasks by @ref task_priority.
+    std::array<size_t, (size_t)task_priority::count> discarded{};
+    task_clock::duration                              took{0};
+
+    /// @brief runs the task before the deadline, discards it by policy
+    /// after, counting either.
+    void retire(task_base::ptr&        task,
+                task_clock::time_point deadline,
+                shutdown_policy        policy);
+    void merge(const task_shutdown_report& other);
+};
+
+/**
+ * @class basic_task_worker
+ *
+ * Executes tasks from its queue until shutdown. The queue type is a policy,
+ * anything providing push(), push_n(), pop(), try_pop(), pop_n() and size()
+ * of @ref task_base::ptr works, where pop() blocks until an item is available
+ * and pop_n() takes up to n items without blocking.
+ *
+ * @ref task_worker uses the mutex based @ref safe_queue, @ref
+ * lockfree_task_worker uses a bounded @ref mpmc_queue, which is the better
+ * choice under many producers, @ref priority_task_worker orders its tasks by
+ * priority and deadline. Since the worker takes up to @ref drain_batch tasks
+ * at once, an urgent task may wait for the rest of the current batch.
+ *
+ * shutdown() drains the queue on the calling thread, stop() lets the worker
+ * thread drain it, so many workers drain in parallel, optionally by a
+ * deadline.
+ */
+template <class queue_t>
+class basic_task_worker
 {
 public:
+    using queue_type = queue_t;
+
+    /// arguments are forwarded to the queue constructor.
+    template <typename... args_t>
+    explicit basic_task_worker(args_t&&... args) :
+        m_tasks(std::forward<args_t>(args)...),
+        m_started(task_clock::now())
+    {
+    }
+
+    /// tasks the worker takes from its queue per lock or per attempt.
+    static constexpr size_t drain_batch = 32;
+
     bool   live() const;
-    bool   add_task(task_base::ptr task);
+    bool   add_task(const task_base::ptr& task);
+    /// the task is moved into the queue, left as is when not live.
+    bool   add_task(task_base::ptr&& task);
     size_t size() { return m_tasks.size(); }
+    /// @brief the queued tasks by a counter, without touching the queue. It
+    /// may be a little off while tasks come and go, good enough to place
+    /// tasks.
+    size_t depth() const { return m_depth.load(std::memory_order_relaxed); }
     void   operator()();
 
+    /// tasks are moved out of the span, with a single wake up for all.
+    bool add_tasks(std::span<task_base::ptr> tasks);
+
+    /// @brief makes room for n tasks when the queue can grow, from the
+    /// calling thread. Called from a pinned worker thread, the queue memory
+    /// is local to its NUMA node.
+    void reserve(size_t n)
+    {
+        if constexpr (requires { m_tasks.reserve(n); })
+            m_tasks.reserve(n);
+    }
+
     // method called from main thread
     void shutdown();
+    /// @brief stops taking tasks and returns at once. The worker thread then
+    /// runs its queued tasks until the deadline and discards the rest by
+    /// policy, see shutdown_report() once it quit.
+    void stop(task_clock::time_point deadline = task_clock::time_point::max(),
+              shutdown_policy        policy   = shutdown_policy::cancel);
+    /// @brief retires the tasks still queued by the stop() deadline, the
+    /// worker thread does it before quitting. Only call it after that, for
+    /// the tasks which slipped in meanwhile.
+    void drain();
+    /// @brief only meaningful once the worker thread quit.
+    const task_shutdown_report& shutdown_report() const { return m_report; }
+
+    /// should be set before the worker starts running.
+    void              set_idle_strategy(const idle_strategy& strategy);
+    task_worker_stats stats();
+
+    /// @brief stamps the tasks when queued and times their runs, for
+    /// metrics(). Should be set before any task is added.
+    void                set_metrics(bool enabled) { m_metrics_on = enabled; }
+    task_worker_metrics metrics();
 
 protected:
-    safe_queue<task_base::ptr> m_tasks;
-    std::atomic_bool           m_live = true;
+    // spin and yield according to the idle strategy, returns the number of
+    // tasks taken, 0 if still empty.
+    size_t try_acquire(task_base::ptr* tasks, size_t max);
+    void   run(task_base::ptr& task);
+
+    // counted before the push, so the worker never takes more than added.
+    void pushed(size_t n) { m_depth.fetch_add(n, std::memory_order_relaxed); }
+    void taken(size_t n) { m_depth.fetch_sub(n, std::memory_order_relaxed); }
+
+    queue_t            m_tasks;
+    std::atomic_bool   m_live  = true;
+    std::atomic_size_t m_depth = 0;
+    idle_strategy      m_idle;
+
+    // only written by the worker thread.
+    std::atomic_size_t m_executed = 0;
+    std::atomic_size_t m_parks    = 0;
+
+    // only written by the worker thread too, when m_metrics_on.
+    bool                    m_metrics_on = false;
+    task_clock::time_point  m_started;
+    task_histogram_recorder m_wait;
+    task_histogram_recorder m_run;
+    std::atomic<uint64_t>   m_busy = 0;
+
+    // set by stop() before m_live is cleared, read by the worker thread after.
+    task_clock::time_point m_stop_deadline = task_clock::time_point::max();
+    shutdown_policy        m_stop_policy   = shutdown_policy::cancel;
+    task_shutdown_report   m_report;
+};
+
+/// lanes by @ref task_priority, ordered by @ref task_base::m_deadline.
+struct task_lane_traits
+{
+    using key_type = task_clock::time_point;
+
+    static constexpr size_t lanes = (size_t)task_priority::count;
+    static constexpr size_t aging = 64;
+
+    // the empty task from shutdown goes first so the worker quits promptly.
+    static size_t lane(const task_base::ptr& task)
+    {
+        return task ? (size_t)task->m_priority : 0;
+    }
+    static key_type key(const task_base::ptr& task)
+    {
+        return task ? task->m_deadline : key_type::min();
+    }
 };
 
+using task_lanes = lane_container<task_base::ptr, task_lane_traits>;
+
+using task_worker = basic_task_worker<safe_queue<task_base::ptr>>;
+using lockfree_task_worker =
+    basic_task_worker<blocking_queue<mpmc_queue<task_base::ptr>>>;
+/// drains the critical tasks first, see @ref task_priority.
+using priority_task_worker = basic_task_worker<safe_queue<task_base::ptr, task_lanes>>;
+
+// instantiated in task_worker.cc
+extern template class basic_task_worker<safe_queue<task_base::ptr>>;
+extern template class basic_task_worker<blocking_queue<mpmc_queue<task_base::ptr>>>;
+extern template class basic_task_worker<safe_queue<task_base::ptr, task_lanes>>;
+
 } // namespace EBUS_NS
@@ -0,0 +1,210 @@
+#pragma once
+
+#ifndef EBUS_NS
+#    define EBUS_NS _ebus_
+#endif
+
+#include "hash.hh"
+#include "singleton.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/**
+ * @struct topic
+ *
+ * A topic name and its id, the FNV-1a of the name. A string literal is
+ * hashed at compile time, other strings when the topic is made, or once by
+ * topic_bus::intern() which keeps the name.
+ *
+ * Names are segments separated by dots, "net.eth0.rx".
+ */
+struct topic
+{
+    template <size_t N>
+    consteval topic(const char (&literal)[N]) :
+        id(fnv1a(std::string_view(literal, N - 1))),
+        name(literal, N - 1)
+    {
+    }
+
+    constexpr explicit topic(std::string_view text) :
+        id(fnv1a(text)),
+        name(text)
+    {
+    }
+
+    uint64_t         id;
+    std::string_view name;
+};
+
+/// subscribers of a topic_index, see topic_handler.
+class topic_subscriber
+{
+protected:
+    topic_subscriber()  = default;
+    ~topic_subscriber() = default;
+};
+
+/**
+ * @class topic_index
+ *
+ * The subscriptions of a topic bus. Patterns are kept in a trie of their
+ * segments, "*" standing for any one segment and a last "**" for any number
+ * of them. Each topic gets its subscriber list when interned, and the lists
+ * of the interned topics a new pattern matches are updated, so a publish
+ * reads a precomputed list.
+ *
+ * A publish takes no lock. Interned topics are never removed, so their
+ * entries stay where they are, and are found in a hash table which is only
+ * replaced, the old ones kept, when it grows. The lists are copied on write:
+ * subscriptions replace them under the lock, a publish loads the list of its
+ * topic once and calls it, unchanged while it runs. Only interning a new
+ * topic or subscribing takes the lock.
+ */
+class topic_index
+{
+public:
+    using subscribers_t = std::vector<topic_subscriber*>;
+    using snapshot_t    = std::shared_ptr<const subscribers_t>;
+
+    topic_index();
+    ~topic_index();
+
+    topic_index(const topic_index&)            = delete;
+    topic_index& operator=(const topic_index&) = delete;
+
+    /// @brief the subscribers of a topic, interning it on first use.
+    snapshot_t subscribers(const topic& t);
+
+    /// @brief interns a topic name, the returned topic names the kept copy.
+    topic intern_topic(std::string_view name);
+
+    /// @brief a subscriber is added once to a topic, whatever the number of
+    /// its patterns matching it. Returns false, subscribing nothing, when a
+    /// "**" is not the last segment of the pattern.
+    bool subscribe(std::string_view pattern, topic_subscriber* subscriber);
+    /// @brief removes every subscription of a subscriber.
+    void unsubscribe(topic_subscriber* subscriber);
+
+    /// @brief number of topics interned.
+    size_t topics() const
+    {
+        std::scoped_lock<std::mutex> lock(m_lock);
+        return m_topics.size();
+    }
+
+    /// @brief whether a topic name matches a subscription pattern.
+    static bool match(std::string_view pattern, std::string_view name);
+
+private:
+    struct node;
+    struct table;
+
+    struct entry
+    {
+        uint64_t                m_id;
+        std::string             m_name;
+        std::atomic<snapshot_t> m_subscribers;
+    };
+
+    // under the lock.
+    entry& intern(std::string_view name);
+
+    std::unique_ptr<node>               m_root;
+    std::vector<std::unique_ptr<entry>> m_topics;
+    std::atomic<const table*>           m_table = nullptr; // the last of m_tables
+    std::vector<std::unique_ptr<table>> m_tables;
+    mutable std::mutex                  m_lock;
+};
+
+template <class interface>
+class topic_handler;
+
+/**
+ * @class topic_bus
+ *
+ * A bus keyed by topic names known at runtime, for plugins which only know
+ * the names. The handlers of an interface subscribe to patterns of topics,
+ * "net.*.rx", and a publish calls the method on the subscribers of the topic,
+ * found as a GROUP multicast finds its group: one hash lookup, then a list.
+ *
+ * Usage Example:
+ * @code
+ * struct packet_iface
+ * {
+ *     virtual void packet(const topic& t, uint32_t bytes) = 0;
+ * };
+ *
+ * struct rx_counter : public topic_handler<packet_iface>
+ * {
+ *     rx_counter() { subscribe("net.*.rx"); }
+ *     void packet(const topic& t, uint32_t bytes) override;
+ * };
+ *
+ * topic_bus<packet_iface>::publish("net.eth0.rx", &packet_iface::packet, 1500u);
+ * @endcode
+ */
+template <class interface>
+class topic_bus
+{
+public:
+    using handler_t = topic_handler<interface>;
+
+    /// @brief calls func on the subscribers of t, the topic first if func
+    /// takes it. The subscribers are those of the call, a handler
+    /// unsubscribing while called does not change who else is called.
+    template <typename function_t, typename... args_t>
+    static void publish(const topic& t, function_t&& func, args_t&&... args)
+    {
+        topic_index::snapshot_t subscribers = index().subscribers(t);
+        for (topic_subscriber* subscriber : *subscribers)
+        {
+            handler_t* handler = static_cast<handler_t*>(subscriber);
+            if constexpr (std::is_invocable_v<function_t, handler_t*, const topic&,
+                                              args_t...>)
+                std::invoke(func, handler, t, args...);
+            else
+                std::invoke(func, handler, args...);
+        }
+    }
+
+    /// @brief interns a topic built at runtime, so its name is hashed once.
+    static topic intern(std::string_view name) { return index().intern_topic(name); }
+
+    static topic_index& index() { return singleton_ref<ctx>::get().m_index; }
+
+private:
+    struct ctx
+    {
+        topic_index m_index;
+    };
+    friend class singleton<ctx>;
+};
+
+/// the handlers of a topic_bus, unsubscribed when destroyed.
+template <class interface>
+class topic_handler : public interface, public topic_subscriber
+{
+public:
+    virtual ~topic_handler() { unsubscribe(); }
+
+protected:
+    bool subscribe(std::string_view pattern)
+    {
+        return topic_bus<interface>::index().subscribe(pattern, this);
+    }
+    void unsubscribe() { topic_bus<interface>::index().unsubscribe(this); }
+};
+
+} // namespace EBUS_NS
@@ -0,0 +1,165 @@
+#include <ebus/hooks.hh>
+#include <ebus/task_graph.hh>
+#include <ebus/task_scheduler.hh>
+
+#include <assert.h>
+#include <functional>
+#include <queue>
+#include <string_view>
+#include <unordered_map>
+
+namespace EBUS_NS
+{
+
+namespace
+{
+
+// the hooks in the order they run serially: of the hooks whose
+// dependencies ran, the first registered. Without dependencies that is the
+// registration order. The hooks of a cycle, and the ones after them, are
+// left out.
+std::vector<size_t>
+hook_order(const std::vector<std::vector<size_t>>& successors,
+           std::vector<uint32_t>                   predecessors)
+{
+    std::vector<size_t> order;
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+    order.reserve(successors.size());
+    for (size_t i = 0; i < successors.size(); i++)
+    {
+        if (predecessors[i] == 0)
+            ready.push(i);
+    }
+    while (!ready.empty())
+    {
+        size_t i = ready.top();
+        ready.pop();
+        order.push_back(i);
+        for (size_t succ : successors[i])
+        {
+            if (--predecessors[succ] == 0)
+                ready.push(succ);
+        }
+    }
+    return order;
+}
+
+} // namespace
+
+hook_report
+run_hook_list(const std::vector<hook_entry>&         hooks,
+              bool                                   parallel,
+              const std::unordered_set<std::string>& ran)
+{
+    hook_report report;
+    report.hooks.resize(hooks.size());
+
+    std::unordered_map<std::string_view, size_t> by_name;
+    for (size_t i = 0; i < hooks.size(); i++)
+    {
+        if (!hooks[i].name)
+            continue;
+        report.hooks[i].name = hooks[i].name;
+        bool unique          = by_name.emplace(hooks[i].name, i).second;
+        assert(unique && "two hooks have the same name");
+        (void)unique;
+    }
+
+    std::vector<std::vector<size_t>> successors(hooks.size());
+    std::vector<uint32_t>            predecessors(hooks.size());
+    std::vector<size_t>              waiting;
+    for (size_t i = 0; i < hooks.size(); i++)
+    {
+        bool missing = false;
+        for (const char* dependency : hooks[i].after)
+        {
+            auto found = by_name.find(dependency);
+            if (found != by_name.end())
+            {
+                successors[found->second].push_back(i);
+                predecessors[i]++;
+            }
+            else if (!ran.contains(dependency))
+                missing = true;
+        }
+        // a predecessor which never comes.
+        if (missing)
+        {
+            predecessors[i]++;
+            waiting.push_back(i);
+        }
+    }
+    // checked before running anything, a graph with a cycle never finishes.
+    std::vector<size_t> order = hook_order(successors, predecessors);
+    if (order.size() != hooks.size())
+    {
+        std::vector<bool> left(hooks.size(), true);
+        for (size_t i : order)
+        {
+            left[i] = false;
+        }
+        // what waits on a missing hook, the rest left out is in or after a
+        // cycle.
+        while (!waiting.empty())
+        {
+            size_t i = waiting.back();
+            waiting.pop_back();
+            if (report.hooks[i].waiting)
+                continue;
+            report.hooks[i].waiting = true;
+            report.waiting          = true;
+            waiting.insert(waiting.end(), successors[i].begin(), successors[i].end());
+        }
+        for (size_t i = 0; i < hooks.size(); i++)
+        {
+            if (left[i] && !report.hooks[i].waiting)
+            {
+                report.hooks[i].skipped = true;
+                report.cycle            = true;
+            }
+        }
+    }
+
+    auto run = [&hooks, &report](size_t i)
+    {
+        task_clock::time_point start = task_clock::now();
+        hooks[i].fn();
+        report.hooks[i].took = task_clock::now() - start;
+    };
+
+    task_clock::time_point start = task_clock::now();
+    if (parallel && order.size() == hooks.size() && hooks.size() > 1 &&
+        task_scheduler_iface::concurrency() > 1)
+    {
+        task_graph graph;
+        for (size_t i = 0; i < hooks.size(); i++)
+        {
+            graph.add_node(
+                [&run, i]()
+                {
+                    run(i);
+                    return true;
+                });
+        }
+        for (size_t i = 0; i < hooks.size(); i++)
+        {
+            for (size_t succ : successors[i])
+            {
+                graph.precede((task_graph::node_id)i, (task_graph::node_id)succ);
+            }
+        }
+        graph.run_and_wait();
+        report.parallel = true;
+    }
+    else
+    {
+        for (size_t i : order)
+        {
+            run(i);
+        }
+    }
+    report.took = task_clock::now() - start;
+    return report;
+}
+
+} // namespace EBUS_NS
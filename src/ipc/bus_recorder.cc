@@ -0,0 +1,279 @@
+#include <ebus/ipc/bus_recorder.hh>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#if !defined(_WIN32)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace EBUS_NS
+{
+
+static constexpr size_t buffer_records = 32; // a block, 4KB
+
+namespace
+{
+
+// the recording lock, taken before the lock of a buffer.
+std::mutex    g_lock;
+bus_recorder* g_active = nullptr;
+
+uint64_t
+now_ns()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               task_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+// the records of a thread, attached to the active recorder on its first one.
+struct bus_recorder::buffer
+{
+    buffer() { m_records.reserve(buffer_records); }
+
+    ~buffer()
+    {
+        std::lock_guard<std::mutex> global(g_lock);
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (bus_recorder* recorder = m_recorder.load(std::memory_order_relaxed))
+        {
+            flush(recorder);
+            std::erase(recorder->m_buffers, this);
+        }
+    }
+
+    void flush(bus_recorder* recorder)
+    {
+        size_t written = recorder->write(m_records.data(), m_records.size());
+        recorder->m_recorded.fetch_add(written, std::memory_order_relaxed);
+        recorder->m_dropped.fetch_add(m_records.size() - written,
+                                      std::memory_order_relaxed);
+        m_records.clear();
+    }
+
+    bool attach()
+    {
+        std::lock_guard<std::mutex> global(g_lock);
+        if (!g_active)
+            return false;
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_recorder.store(g_active, std::memory_order_relaxed);
+        g_active->m_buffers.push_back(this);
+        return true;
+    }
+
+    // only contended while the recorder stops.
+    std::mutex                 m_lock;
+    std::atomic<bus_recorder*> m_recorder = nullptr;
+    std::vector<bus_record>    m_records;
+};
+
+bus_recorder::buffer&
+bus_recorder::local_buffer()
+{
+    thread_local buffer t_buffer;
+    return t_buffer;
+}
+
+void
+bus_recorder::record(const bus_record& record)
+{
+    buffer& local = local_buffer();
+    if (!local.m_recorder.load(std::memory_order_relaxed) && !local.attach())
+        return;
+
+    std::lock_guard<std::mutex> lock(local.m_lock);
+    bus_recorder* recorder = local.m_recorder.load(std::memory_order_relaxed);
+    if (!recorder)
+        return; // stopped meanwhile
+
+    local.m_records.push_back(record);
+    local.m_records.back().time = now_ns();
+    if (local.m_records.size() >= buffer_records)
+        local.flush(recorder);
+}
+
+void
+bus_recorder::stop()
+{
+    {
+        std::lock_guard<std::mutex> global(g_lock);
+        if (g_active == this)
+        {
+            g_active = nullptr;
+            bus_tap::set_sink(nullptr);
+        }
+        for (buffer* attached : m_buffers)
+        {
+            std::lock_guard<std::mutex> lock(attached->m_lock);
+            attached->flush(this);
+            attached->m_recorder.store(nullptr, std::memory_order_relaxed);
+        }
+        m_buffers.clear();
+    }
+    m_tracked.clear();
+
+#if !defined(_WIN32)
+    if (m_header)
+    {
+        uint64_t length = std::min(m_header->m_length.load(), m_header->m_capacity);
+        munmap(m_header, m_bytes);
+        if (ftruncate(m_fd, (off_t)(sizeof(bus_log_header) + length)) != 0)
+        {
+            // the log keeps its capacity, the replayer ignores the tail.
+        }
+        close(m_fd);
+    }
+#endif
+    m_header = nullptr;
+    m_fd     = -1;
+}
+
+bus_recorder::~bus_recorder()
+{
+    stop();
+}
+
+size_t
+bus_recorder::write(const bus_record* records, size_t count)
+{
+    uint64_t bytes = count * sizeof(bus_record);
+    uint64_t at    = m_header->m_length.fetch_add(bytes, std::memory_order_relaxed);
+    if (at >= m_header->m_capacity)
+        return 0;
+
+    size_t left = (size_t)(m_header->m_capacity - at) / sizeof(bus_record);
+    size_t fit  = std::min(count, left);
+    std::memcpy((std::byte*)(m_header + 1) + at, records, fit * sizeof(bus_record));
+    return fit;
+}
+
+#if !defined(_WIN32)
+
+bus_recorder::bus_recorder(const std::string& path, size_t capacity)
+{
+    uint64_t records = (uint64_t)capacity * sizeof(bus_record);
+    size_t   bytes   = sizeof(bus_log_header) + records;
+
+    int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0)
+        return;
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, (off_t)bytes) == 0)
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED)
+    {
+        close(fd);
+        return;
+    }
+
+    m_header                = new (memory) bus_log_header{};
+    m_header->m_magic       = bus_log_header::magic;
+    m_header->m_version     = bus_log_header::version;
+    m_header->m_record_size = sizeof(bus_record);
+    m_header->m_capacity    = records;
+    m_header->m_start       = now_ns();
+    m_bytes                 = bytes;
+    m_fd                    = fd;
+
+    std::lock_guard<std::mutex> global(g_lock);
+    assert(!g_active && "a single recorder records at a time");
+    g_active = this;
+    bus_tap::set_sink(&bus_recorder::record);
+}
+
+bus_replayer::bus_replayer(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    void*       memory = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(bus_log_header))
+        memory = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+        return;
+
+    const bus_log_header* header = static_cast<const bus_log_header*>(memory);
+    if (header->m_magic != bus_log_header::magic ||
+        header->m_version != bus_log_header::version ||
+        header->m_record_size != sizeof(bus_record))
+    {
+        munmap(memory, (size_t)st.st_size);
+        return;
+    }
+    m_memory = memory;
+    m_bytes  = (size_t)st.st_size;
+
+    // a log not stopped holds its whole capacity, with the blocks reserved
+    // but never written left zeroed.
+    uint64_t length = std::min<uint64_t>(
+        {header->m_length.load(), header->m_capacity, m_bytes - sizeof(bus_log_header)});
+    const bus_record* records = reinterpret_cast<const bus_record*>(header + 1);
+    for (size_t i = 0; i < length / sizeof(bus_record); i++)
+    {
+        if (records[i].iface != 0)
+            m_records.push_back(&records[i]);
+    }
+    std::stable_sort(m_records.begin(), m_records.end(),
+                     [](const bus_record* a, const bus_record* b)
+                     { return a->time < b->time; });
+}
+
+bus_replayer::~bus_replayer()
+{
+    if (m_memory)
+        munmap(m_memory, m_bytes);
+}
+
+#else
+
+bus_recorder::bus_recorder(const std::string&, size_t)
+{
+}
+
+bus_replayer::bus_replayer(const std::string&)
+{
+}
+
+bus_replayer::~bus_replayer()
+{
+}
+
+#endif
+
+size_t
+bus_replayer::replay(replay_speed speed)
+{
+    if (m_records.empty())
+        return 0;
+
+    task_clock::time_point start = task_clock::now();
+    uint64_t               first = m_records.front()->time;
+    size_t                 count = 0;
+    for (const bus_record* record : m_records)
+    {
+        if (speed == replay_speed::original)
+        {
+            auto at = std::chrono::nanoseconds(record->time - first);
+            std::this_thread::sleep_until(start + at);
+        }
+        if (m_table.dispatch(*record))
+            count++;
+        else
+            m_unknown++;
+    }
+    return count;
+}
+
+} // namespace EBUS_NS
@@ -0,0 +1,419 @@
+#include <ebus/ipc/shm_ring.hh>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#if defined(__linux__)
+#    include <fcntl.h>
+#    include <linux/futex.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+namespace EBUS_NS
+{
+
+static constexpr size_t   cache_line = 64;
+static constexpr uint64_t shm_magic  = 0x65627573'72696e67; // "ebusring"
+
+struct shm_ring::header
+{
+    std::atomic<uint64_t> m_magic; // set last by the creator
+    uint64_t              m_capacity;
+
+    // producers and consumers hammer different cursors, keep them apart.
+    alignas(cache_line) std::atomic<uint64_t> m_enqueue_pos;
+    alignas(cache_line) std::atomic<uint64_t> m_dequeue_pos;
+
+    alignas(cache_line) std::atomic<uint32_t> m_doorbell;
+    std::atomic<uint32_t> m_sleepers;
+};
+
+struct shm_ring::cell
+{
+    std::atomic<uint64_t> m_seq;
+    bus_record            m_record;
+};
+
+// shared between processes, so lock free and address free.
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+namespace
+{
+
+size_t
+round_capacity(size_t capacity)
+{
+    size_t result = 2;
+    while (result < capacity)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+size_t
+shm_ring::segment_bytes(size_t capacity)
+{
+    size_t cells = (sizeof(header) + alignof(cell) - 1) / alignof(cell) * alignof(cell);
+    return cells + capacity * sizeof(cell);
+}
+
+shm_ring::~shm_ring()
+{
+    reset();
+}
+
+shm_ring::shm_ring(shm_ring&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+shm_ring&
+shm_ring::operator=(shm_ring&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        m_header = std::exchange(other.m_header, nullptr);
+        m_cells  = std::exchange(other.m_cells, nullptr);
+        m_mask   = std::exchange(other.m_mask, 0);
+        m_bytes  = std::exchange(other.m_bytes, 0);
+        m_name   = std::move(other.m_name);
+        other.m_name.clear();
+    }
+    return *this;
+}
+
+#if defined(__linux__)
+
+namespace
+{
+
+void*
+map(int fd, size_t bytes)
+{
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+long
+futex(std::atomic<uint32_t>& word, int op, uint32_t value, const timespec* timeout)
+{
+    // not FUTEX_PRIVATE_FLAG, the word is shared between processes.
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), op, value, timeout,
+                   nullptr, 0);
+}
+
+} // namespace
+
+shm_ring
+shm_ring::create(const std::string& name, size_t capacity)
+{
+    shm_ring ring;
+    capacity     = round_capacity(capacity);
+    size_t bytes = segment_bytes(capacity);
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        return ring;
+    void* memory = ftruncate(fd, (off_t)bytes) == 0 ? map(fd, bytes) : nullptr;
+    close(fd);
+    if (!memory)
+    {
+        shm_unlink(name.c_str());
+        return ring;
+    }
+
+    // the segment comes zeroed, only the sequences need a value.
+    ring.m_header = new (memory) header;
+    ring.m_cells  = reinterpret_cast<cell*>((std::byte*)memory + segment_bytes(0));
+    ring.m_mask   = capacity - 1;
+    ring.m_bytes  = bytes;
+    ring.m_name   = name;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        ring.m_cells[i].m_seq.store(i, std::memory_order_relaxed);
+    }
+    ring.m_header->m_capacity = capacity;
+    ring.m_header->m_magic.store(shm_magic, std::memory_order_release);
+    return ring;
+}
+
+shm_ring
+shm_ring::open(const std::string& name)
+{
+    shm_ring ring;
+    int      fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+        return ring;
+
+    struct stat st;
+    void*       memory = nullptr;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= segment_bytes(0))
+        memory = map(fd, (size_t)st.st_size);
+    close(fd);
+    if (!memory)
+        return ring;
+
+    // the capacity is only written before the magic.
+    header* h        = static_cast<header*>(memory);
+    bool    ready    = h->m_magic.load(std::memory_order_acquire) == shm_magic;
+    size_t  capacity = ready ? (size_t)h->m_capacity : 0;
+    size_t  cells    = ((size_t)st.st_size - segment_bytes(0)) / sizeof(cell);
+    if (!ready || capacity < 2 || (capacity & (capacity - 1)) != 0 ||
+        capacity > cells || segment_bytes(capacity) != (size_t)st.st_size)
+    {
+        // not made by create(), not done yet, or corrupted.
+        munmap(memory, (size_t)st.st_size);
+        return ring;
+    }
+    ring.m_header = h;
+    ring.m_cells  = reinterpret_cast<cell*>((std::byte*)memory + segment_bytes(0));
+    ring.m_mask   = capacity - 1;
+    ring.m_bytes  = (size_t)st.st_size;
+    return ring;
+}
+
+void
+shm_ring::reset()
+{
+    if (m_header)
+        munmap(m_header, m_bytes);
+    if (!m_name.empty())
+        shm_unlink(m_name.c_str());
+    m_header = nullptr;
+    m_cells  = nullptr;
+    m_name.clear();
+}
+
+void
+shm_ring::notify()
+{
+    if (!valid())
+        return;
+    // pairs with wait(): either the consumer reads the new doorbell and does
+    // not sleep, or it counted itself as a sleeper before we look.
+    m_header->m_doorbell.fetch_add(1, std::memory_order_seq_cst);
+    if (m_header->m_sleepers.load(std::memory_order_seq_cst) > 0)
+        futex(m_header->m_doorbell, FUTEX_WAKE, INT32_MAX, nullptr);
+}
+
+bool
+shm_ring::wait(task_clock::duration timeout)
+{
+    if (!valid())
+        return false;
+    uint32_t bell = m_header->m_doorbell.load(std::memory_order_seq_cst);
+    if (size() > 0)
+        return true;
+
+    auto     ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+    timespec ts{(time_t)(ns / 1000000000), (long)(ns % 1000000000)};
+    m_header->m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+    if (size() == 0)
+        futex(m_header->m_doorbell, FUTEX_WAIT, bell, &ts);
+    m_header->m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+    return size() > 0;
+}
+
+#else
+
+shm_ring
+shm_ring::create(const std::string&, size_t)
+{
+    return shm_ring();
+}
+
+shm_ring
+shm_ring::open(const std::string&)
+{
+    return shm_ring();
+}
+
+void
+shm_ring::reset()
+{
+}
+
+void
+shm_ring::notify()
+{
+}
+
+bool
+shm_ring::wait(task_clock::duration)
+{
+    return false;
+}
+
+#endif
+
+size_t
+shm_ring::size() const
+{
+    if (!valid())
+        return 0;
+    uint64_t tail = m_header->m_dequeue_pos.load(std::memory_order_relaxed);
+    uint64_t head = m_header->m_enqueue_pos.load(std::memory_order_relaxed);
+    return head > tail ? (size_t)(head - tail) : 0;
+}
+
+bool
+shm_ring::try_push(const bus_record& record)
+{
+    if (!valid())
+        return false;
+    cell*    c   = nullptr;
+    uint64_t pos = m_header->m_enqueue_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        c               = &m_cells[pos & m_mask];
+        uint64_t  seq   = c->m_seq.load(std::memory_order_acquire);
+        ptrdiff_t delta = (ptrdiff_t)seq - (ptrdiff_t)pos;
+        if (delta == 0)
+        {
+            if (m_header->m_enqueue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (delta < 0)
+        {
+            return false; // full
+        }
+        else
+        {
+            pos = m_header->m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    std::memcpy(&c->m_record, &record, sizeof(bus_record));
+    c->m_seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool
+shm_ring::try_pop(bus_record& record)
+{
+    if (!valid())
+        return false;
+    cell*    c   = nullptr;
+    uint64_t pos = m_header->m_dequeue_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        c               = &m_cells[pos & m_mask];
+        uint64_t  seq   = c->m_seq.load(std::memory_order_acquire);
+        ptrdiff_t delta = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+        if (delta == 0)
+        {
+            if (m_header->m_dequeue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (delta < 0)
+        {
+            return false; // empty
+        }
+        else
+        {
+            pos = m_header->m_dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    std::memcpy(&record, &c->m_record, sizeof(bus_record));
+    c->m_seq.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+}
+
+size_t
+shm_ring::pop_n(std::span<bus_record> out)
+{
+    size_t n = 0;
+    for (; n < out.size() && try_pop(out[n]); n++)
+    {
+    }
+    return n;
+}
+
+shm_sender::shm_sender(shm_ring& ring, size_t batch, task_clock::duration timeout) :
+    m_ring(ring),
+    m_batch(std::max<size_t>(1, batch)),
+    m_timeout(timeout)
+{
+    m_pending.reserve(m_batch);
+}
+
+void
+shm_sender::add(const bus_record& record)
+{
+    m_pending.push_back(record);
+    if (m_pending.size() >= m_batch)
+        flush();
+}
+
+bool
+shm_sender::flush_until(task_clock::time_point deadline)
+{
+    if (m_pending.empty())
+        return true;
+    size_t pushed = 0;
+    while (pushed < m_pending.size())
+    {
+        if (m_ring.try_push(m_pending[pushed]))
+        {
+            pushed++;
+            continue;
+        }
+        // full, the consumers may be asleep on what is already there.
+        m_ring.notify();
+        if (task_clock::now() >= deadline)
+            break;
+        std::this_thread::yield();
+    }
+    m_dropped += m_pending.size() - pushed;
+    bool all = pushed == m_pending.size();
+    m_pending.clear();
+    m_ring.notify();
+    return all;
+}
+
+shm_receiver::shm_receiver(shm_ring& ring) :
+    m_ring(ring)
+{
+}
+
+size_t
+shm_receiver::poll(size_t max)
+{
+    bus_record records[16];
+    size_t     total = 0;
+    while (total < max)
+    {
+        size_t n = m_ring.pop_n(std::span(records, std::min<size_t>(16, max - total)));
+        for (size_t i = 0; i < n; i++)
+        {
+            if (!m_table.dispatch(records[i]))
+                m_unknown++;
+        }
+        total += n;
+        if (n == 0)
+            break;
+    }
+    return total;
+}
+
+size_t
+shm_receiver::wait_and_poll(task_clock::duration timeout, size_t max)
+{
+    if (!m_ring.wait(timeout))
+        return 0;
+    return poll(max);
+}
+
+} // namespace EBUS_NS
@@ -0,0 +1,102 @@
+#include <ebus/affinity_queue.hh>
+
+namespace EBUS_NS
+{
+
+bool
+task_scheduler_iface::add_task(affinity_tag tag, task_base::ptr task)
+{
+    bool result = false;
+    affinity_queue_bus::invoke(result,
+                               tag,
+                               &affinity_queue_iface::m_add_task,
+                               move_ref(task));
+    return result;
+}
+
+affinity_queue::affinity_queue(std::string_view name, size_t capacity) :
+    m_tag(affinity_tag_of(name)),
+    m_tasks(capacity)
+{
+    m_connected = handler_t::connect(m_tag);
+}
+
+affinity_queue::~affinity_queue()
+{
+    if (m_connected)
+        handler_t::disconnect();
+}
+
+size_t
+affinity_queue::size() const
+{
+    std::lock_guard<std::mutex> lock(m_overflow_lock);
+    return m_tasks.size() + m_overflow.size();
+}
+
+bool
+affinity_queue::m_add_task(task_base::ptr task)
+{
+    // once spilled, keep spilling until drained, for the order.
+    if (!m_spilled.load(std::memory_order_acquire) && m_tasks.try_push(std::move(task)))
+        return true;
+
+    std::lock_guard<std::mutex> lock(m_overflow_lock);
+    m_overflow.push_back(std::move(task));
+    m_spilled.store(true, std::memory_order_release);
+    return true;
+}
+
+bool
+affinity_queue::try_pop(task_base::ptr& task)
+{
+    if (m_tasks.try_pop(task))
+        return true;
+    if (!m_spilled.load(std::memory_order_acquire))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_overflow_lock);
+    if (m_overflow.empty())
+    {
+        m_spilled.store(false, std::memory_order_release);
+        return false;
+    }
+    task = std::move(m_overflow.front());
+    m_overflow.pop_front();
+    if (m_overflow.empty())
+        m_spilled.store(false, std::memory_order_release);
+    return true;
+}
+
+size_t
+affinity_queue::run_pending(size_t max_tasks)
+{
+    size_t         ran = 0;
+    task_base::ptr task;
+    while (ran < max_tasks && try_pop(task))
+    {
+        task->run();
+        task.reset();
+        ran++;
+    }
+    return ran;
+}
+
+size_t
+affinity_queue::run_pending(task_clock::duration budget)
+{
+    size_t         ran      = 0;
+    auto           deadline = task_clock::now() + budget;
+    task_base::ptr task;
+    do
+    {
+        if (!try_pop(task))
+            break;
+        task->run();
+        task.reset();
+        ran++;
+    } while (task_clock::now() < deadline);
+    return ran;
+}
+
+} // namespace EBUS_NS
@@ -0,0 +1,77 @@
+#include <ebus/parallel.hh>
+#include <ebus/task_scheduler.hh>
+
+namespace EBUS_NS
+{
+
+parallel_job::parallel_job(size_t nchunks) :
+    m_nchunks(nchunks)
+{
+    m_function = [this]()
+    {
+        work();
+        return true;
+    };
+}
+
+void
+parallel_job::add_ref()
+{
+    m_refcount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+parallel_job::release()
+{
+    if (m_refcount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete this;
+}
+
+size_t
+parallel_job::chunks(size_t n, size_t grain, size_t threads)
+{
+    if (n == 0)
+        return 0;
+    size_t max_chunks = std::max<size_t>(1, threads) * 8;
+    size_t by_grain   = grain ? (n + grain - 1) / grain : n;
+    return std::max<size_t>(1, std::min(max_chunks, by_grain));
+}
+
+void
+parallel_job::execute(size_t helpers)
+{
+    if (helpers > 0)
+    {
+        std::vector<task_base::ptr> tasks(helpers, task_base::ptr(this));
+        task_scheduler_iface::add_tasks(tasks);
+    }
+    work();
+
+    size_t completed = m_completed.load(std::memory_order_acquire);
+    while (completed < m_nchunks)
+    {
+        m_completed.wait(completed, std::memory_order_acquire);
+        completed = m_completed.load(std::memory_order_acquire);
+    }
+}
+
+void
+parallel_job::work()
+{
+    size_t chunk = m_next.fetch_add(1, std::memory_order_relaxed);
+    for (; chunk < m_nchunks; chunk = m_next.fetch_add(1, std::memory_order_relaxed))
+    {
+        run_chunk(chunk);
+        // the helpers hold a reference, notifying on a finished job is safe.
+        if (m_completed.fetch_add(1, std::memory_order_acq_rel) + 1 == m_nchunks)
+            m_completed.notify_all();
+    }
+}
+
+size_t
+parallel_threads()
+{
+    return task_scheduler_iface::concurrency();
+}
+
+} // namespace EBUS_NS
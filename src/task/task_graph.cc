@@ -0,0 +1,178 @@
+#include <ebus/task_graph.hh>
+#include <ebus/task_scheduler.hh>
+
+#include <assert.h>
+
+namespace EBUS_NS
+{
+
+task_graph::node::node(task_graph& graph, node_id id, const exec_fn& fn) :
+    task_base(fn),
+    m_graph(graph),
+    m_id(id)
+{
+}
+
+void
+task_graph::node::task_done()
+{
+    m_graph.node_done(*this);
+}
+
+void
+task_graph::node::add_ref()
+{
+    m_refcount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+task_graph::node::release()
+{
+    if (m_refcount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        m_graph.node_released();
+}
+
+task_graph::~task_graph()
+{
+    // nodes may still be on the workers.
+    wait();
+}
+
+task_graph::node_id
+task_graph::add_node(const task_base::exec_fn& fn, task_priority priority)
+{
+    assert(!running() && "You cannot modify a running task_graph");
+
+    node_id id = (node_id)m_nodes.size();
+    m_nodes.emplace_back(new node(*this, id, fn));
+    m_nodes.back()->m_priority = priority;
+    m_dirty                    = true;
+    return id;
+}
+
+void
+task_graph::precede(node_id before, node_id after)
+{
+    assert(!running() && "You cannot modify a running task_graph");
+    assert(before < m_nodes.size() && after < m_nodes.size() && before != after);
+
+    node& from = *m_nodes[before];
+    from.m_successors.push_back(after);
+    from.m_ready.resize(from.m_successors.size());
+    m_nodes[after]->m_predecessors++;
+    m_dirty = true;
+}
+
+void
+task_graph::prepare()
+{
+    if (!m_dirty)
+        return;
+
+    m_roots.clear();
+    for (auto& n : m_nodes)
+    {
+        if (n->m_predecessors == 0)
+            m_roots.push_back(n->m_id);
+    }
+    m_ready_roots.resize(m_roots.size());
+
+    // Kahn's algorithm, every node has to be reachable from the roots.
+    std::vector<uint32_t> pending(m_nodes.size());
+    std::vector<node_id>  ready(m_roots);
+    size_t                visited = 0;
+    for (auto& n : m_nodes)
+    {
+        pending[n->m_id] = n->m_predecessors;
+    }
+    while (!ready.empty())
+    {
+        node_id id = ready.back();
+        ready.pop_back();
+        visited++;
+        for (node_id succ : m_nodes[id]->m_successors)
+        {
+            if (--pending[succ] == 0)
+                ready.push_back(succ);
+        }
+    }
+    assert(visited == m_nodes.size() && "task_graph has a cycle");
+    (void)visited;
+    m_dirty = false;
+}
+
+void
+task_graph::run()
+{
+    prepare();
+    if (m_nodes.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        assert(m_done && "task_graph is already running");
+        m_done = false;
+    }
+    for (auto& n : m_nodes)
+    {
+        n->m_pending.store(n->m_predecessors, std::memory_order_relaxed);
+    }
+    m_remaining.store((uint32_t)m_nodes.size(), std::memory_order_release);
+
+    for (size_t i = 0; i < m_roots.size(); i++)
+    {
+        m_ready_roots[i] = m_nodes[m_roots[i]].get();
+    }
+    task_scheduler_iface::add_tasks(m_ready_roots);
+}
+
+bool
+task_graph::running()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return !m_done;
+}
+
+void
+task_graph::wait()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_cv.wait(lock, [this]() { return m_done; });
+}
+
+void
+task_graph::node_done(node& done)
+{
+    size_t nready = 0;
+    for (node_id id : done.m_successors)
+    {
+        node& succ = *m_nodes[id];
+        if (succ.m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            done.m_ready[nready++] = &succ;
+        }
+    }
+    if (nready == 1)
+    {
+        task_scheduler_iface::add_task(std::move(done.m_ready[0]));
+    }
+    else if (nready > 1)
+    {
+        task_scheduler_iface::add_tasks(std::span(done.m_ready.data(), nready));
+    }
+}
+
+void
+task_graph::node_released()
+{
+    if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        // notify under the lock, wait() cannot return, and the graph cannot
+        // go away, before we are done touching it.
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_done = true;
+        m_cv.notify_all();
+    }
+}
+
+} // namespace EBUS_NS
@@ -0,0 +1,166 @@
+#include <ebus/task_metrics.hh>
+
+#include <algorithm>
+#include <bit>
+
+namespace EBUS_NS
+{
+
+size_t
+task_histogram::bucket(task_clock::duration d)
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    if (ns <= 0)
+        return 0;
+    return std::min<size_t>(std::bit_width((uint64_t)ns), buckets - 1);
+}
+
+void
+task_histogram::add(task_clock::duration d)
+{
+    counts[bucket(d)]++;
+    count++;
+    total += d;
+}
+
+void
+task_histogram::merge(const task_histogram& other)
+{
+    for (size_t i = 0; i < buckets; i++)
+    {
+        counts[i] += other.counts[i];
+    }
+    count += other.count;
+    total += other.total;
+}
+
+task_clock::duration
+task_histogram::mean() const
+{
+    return count ? total / (task_clock::rep)count : task_clock::duration::zero();
+}
+
+task_clock::duration
+task_histogram::percentile(double q) const
+{
+    if (count == 0)
+        return task_clock::duration::zero();
+
+    // the sample of rank ceil(q * count), at least the first.
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q * (double)count + 0.999999));
+    uint64_t seen = 0;
+    size_t   i    = 0;
+    for (; i < buckets - 1; i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+            break;
+    }
+    return std::chrono::duration_cast<task_clock::duration>(
+        std::chrono::nanoseconds(i ? uint64_t(1) << i : 0));
+}
+
+task_histogram
+task_histogram_recorder::snapshot() const
+{
+    task_histogram result;
+    for (size_t i = 0; i < task_histogram::buckets; i++)
+    {
+        result.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    }
+    result.count = m_count.load(std::memory_order_relaxed);
+    result.total = task_clock::duration(
+        (task_clock::rep)m_total.load(std::memory_order_relaxed));
+    return result;
+}
+
+size_t
+task_scheduler_metrics::queue_depth() const
+{
+    size_t result = 0;
+    for (const auto& worker : workers)
+    {
+        result += worker.queue_depth;
+    }
+    return result;
+}
+
+uint64_t
+task_scheduler_metrics::executed() const
+{
+    uint64_t result = 0;
+    for (const auto& worker : workers)
+    {
+        result += worker.executed;
+    }
+    return result;
+}
+
+task_histogram
+task_scheduler_metrics::wait() const
+{
+    task_histogram result;
+    for (const auto& worker : workers)
+    {
+        result.merge(worker.wait);
+    }
+    return result;
+}
+
+task_histogram
+task_scheduler_metrics::run() const
+{
+    task_histogram result;
+    for (const auto& worker : workers)
+    {
+        result.merge(worker.run);
+    }
+    return result;
+}
+
+task_clock::duration
+task_scheduler_metrics::busy() const
+{
+    task_clock::duration result{0};
+    for (const auto& worker : workers)
+    {
+        result += worker.busy;
+    }
+    return result;
+}
+
+task_clock::duration
+task_scheduler_metrics::idle() const
+{
+    task_clock::duration result{0};
+    for (const auto& worker : workers)
+    {
+        result += worker.idle;
+    }
+    return result;
+}
+
+double
+task_scheduler_metrics::imbalance() const
+{
+    task_clock::duration total = busy();
+    if (workers.empty() || total <= task_clock::duration::zero())
+        return 0.0;
+
+    task_clock::duration busiest{0};
+    for (const auto& worker : workers)
+    {
+        busiest = std::max(busiest, worker.busy);
+    }
+    return (double)busiest.count() * (double)workers.size() / (double)total.count();
+}
+
+task_scheduler_metrics
+task_metrics_iface::snapshot()
+{
+    task_scheduler_metrics result;
+    task_metrics_bus::invoke(result, &task_metrics_iface::m_snapshot);
+    return result;
+}
+
+} // namespace EBUS_NS
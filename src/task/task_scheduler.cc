@@ -1,108 +1,153 @@
 #include <ebus/task_scheduler.hh>
 #include <ebus/task_worker.hh>
 
+#include "thread_util.hh"
+
 #include <atomic>
 #include <algorithm>
+#include <condition_variable>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
+
+#include <assert.h>
 
 namespace EBUS_NS
 {
-class simple_task : public rescheduable_task
+/**
+ * The steps of a chain, stored in the task itself up to @ref inline_steps,
+ * in a single vector past that. A step runs right after the previous one on
+ * the same worker unless it was added with hand_off().
+ */
+class simple_task : public rescheduable_task, public ref_counted<simple_task>
 {
+    using counted_t = ref_counted<simple_task>;
+
 public:
-    simple_task(const task_base::exec_fn& func, simple_task* prev_task = nullptr);
+    explicit simple_task(task_base::exec_fn func);
     virtual ~simple_task();
 
+    // a whole chain is one block of the pool, unless it spills.
+    static void* operator new(size_t) { return pool::allocate(); }
+    static void  operator delete(void* p) { pool::deallocate(p); }
+
     // intrusive_ptr overrides
-    virtual void add_ref() override;
-    virtual void release() override;
+    virtual void add_ref() override { counted_t::add_ref(); }
+    virtual void release() override { counted_t::release(); }
 
     // task API
     virtual ptr  reschedule(exec_fn&& func) override;
+    virtual ptr  hand_off(exec_fn&& func) override;
     virtual void finish(fini_fn&& func) override;
     virtual void task_done() override;
+    // the chain is broken, the following steps and fini never run.
+    virtual void task_cancelled() override {}
+
+    static constexpr size_t inline_steps = 8;
 
 private:
-    std::atomic_size_t m_refcount = 0;
-    // next task is used to schedule
-    ptr m_next_task{};
-    // prev task. Used to trace back to the first added task.
-    simple_task* m_prev_task = nullptr;
+    using pool = block_pool<512>;
+
+    struct step
+    {
+        exec_fn m_exec;
+        bool    m_hand_off = false;
+    };
+
+    void  append(exec_fn&& func, bool hand_off);
+    step* steps() { return m_spill.empty() ? m_inline : m_spill.data(); }
+    // runs the steps up to the next hand off.
+    bool run_steps();
+
+    size_t            m_count = 0; // steps added
+    size_t            m_next  = 0; // the next step to run
+    step              m_inline[inline_steps];
+    std::vector<step> m_spill;
 };
 
-simple_task::simple_task(const task_base::exec_fn& func, simple_task* prev_task) :
-    m_prev_task(prev_task)
+simple_task::simple_task(task_base::exec_fn func)
 {
-    m_function = func;
+    append(std::move(func), false);
+    m_function = [this]() { return run_steps(); };
 }
 
 simple_task::~simple_task() {}
 
 void
-simple_task::add_ref()
+simple_task::append(exec_fn&& func, bool hand_off)
 {
-    m_refcount.fetch_add(1);
+    if (m_count == inline_steps)
+    {
+        // moved once, the steps stay contiguous.
+        m_spill.reserve(2 * inline_steps);
+        for (step& s : m_inline)
+        {
+            m_spill.push_back(std::move(s));
+        }
+    }
+    if (m_count < inline_steps)
+        m_inline[m_count] = step{std::move(func), hand_off};
+    else
+        m_spill.push_back(step{std::move(func), hand_off});
+    m_count++;
 }
 
-void
-simple_task::release()
+// the chain is only built by the thread which created it, before finish().
+rescheduable_task::ptr
+simple_task::reschedule(task_base::exec_fn&& exec)
 {
-    if (m_refcount.fetch_sub(1) <= 0)
-        delete this;
+    append(std::move(exec), false);
+    return rescheduable_task::ptr(this);
 }
 
-// reschedule a task, this is not easy
 rescheduable_task::ptr
-simple_task::reschedule(task_base::exec_fn&& exec)
+simple_task::hand_off(task_base::exec_fn&& exec)
 {
-    if (m_next_task)
-    {
-        return nullptr;
-    }
-    m_next_task = rescheduable_task::ptr(new simple_task(std::move(exec), this));
-    return m_next_task;
+    append(std::move(exec), true);
+    return rescheduable_task::ptr(this);
 }
 
 void
 simple_task::finish(fini_fn&& fn)
 {
-    m_fini_task = fn;
+    m_fini_task = std::move(fn);
 
     // It is the point to schedule task now
-    simple_task* task = this;
-    while (task->m_prev_task)
-    {
-        task = task->m_prev_task;
-    }
+    task_scheduler_iface::add_task(task_base::ptr(this));
+}
+
+bool
+simple_task::run_steps()
+{
+    step* all = steps();
+    do
     {
-        task_base::ptr first_task(task); //+1
-        task_scheduler_bus::broadcast(&task_scheduler_iface::m_add_task,
-                                      std::ref(first_task));
-        //-1
-    }
+        all[m_next++].m_exec();
+    } while (m_next < m_count && !all[m_next].m_hand_off && !cancelled());
+    return true;
 }
 
 void
 simple_task::task_done()
 {
-    if (m_next_task)
+    // cancelled while running.
+    if (cancelled())
+        return;
+    if (m_next < m_count)
     {
-        task_base::ptr task(m_next_task); //+1
-        // now it is a good to schedule the next task if available.  We are
-        // safe to pass in rescheduable_task::ptr here since the
-        // default_task_scheduler is implementing the task_schedule_bus (which
-        // gives us the simple_task).
-        task_scheduler_bus::broadcast(&task_scheduler_iface::m_add_task, std::ref(task));
-        //-1
+        // a hand off, the chain goes back to the scheduler for its next step.
+        task_scheduler_iface::add_task(task_base::ptr(this));
     }
     else if (m_fini_task)
     {
         m_fini_task();
     }
-    // else, we need to reschedule
 }
 
+static_assert(sizeof(simple_task) <= 512, "simple_task outgrew its pool blocks");
+
 } // namespace EBUS_NS
 
 namespace EBUS_NS
@@ -111,7 +156,40 @@ namespace EBUS_NS
 void
 task_scheduler_iface::add_task(task_base::ptr task)
 {
-    task_scheduler_bus::broadcast(&task_scheduler_iface::m_add_task, std::ref(task));
+    task_scheduler_bus::broadcast(&task_scheduler_iface::m_add_task, move_ref(task));
+}
+
+void
+task_scheduler_iface::add_task(task_base::ptr         task,
+                               task_priority          priority,
+                               task_clock::time_point deadline)
+{
+    task->m_priority = priority;
+    task->m_deadline = deadline;
+    add_task(std::move(task));
+}
+
+void
+task_scheduler_iface::add_tasks(std::span<task_base::ptr> tasks)
+{
+    task_scheduler_bus::broadcast(&task_scheduler_iface::m_add_tasks, tasks);
+}
+
+void
+task_scheduler_iface::m_add_tasks(std::span<task_base::ptr> tasks)
+{
+    for (task_base::ptr& task : tasks)
+    {
+        m_add_task(std::move(task));
+    }
+}
+
+size_t
+task_scheduler_iface::concurrency()
+{
+    size_t result = 0;
+    task_scheduler_bus::invoke(result, &task_scheduler_iface::m_concurrency);
+    return result;
 }
 
 rescheduable_task::ptr
@@ -124,55 +202,423 @@ task_scheduler_iface::add_rescheduable_task(const task_base::exec_fn& fn)
     return result;
 }
 
+rescheduable_task::ptr
+task_scheduler_iface::add_rescheduable_task(const task_base::exec_fn& fn,
+                                            const cancel_token&       token)
+{
+    rescheduable_task::ptr result = add_rescheduable_task(fn);
+    if (result)
+        result->m_cancel = token;
+    return result;
+}
+
+task_scheduler_iface::timer_id
+task_scheduler_iface::add_task_after(task_clock::duration delay, task_base::ptr task)
+{
+    return add_task_at(now() + delay, std::move(task));
+}
+
+task_scheduler_iface::timer_id
+task_scheduler_iface::add_task_at(task_clock::time_point when, task_base::ptr task)
+{
+    timer_id result = 0;
+    task_scheduler_bus::invoke(result,
+                               &task_scheduler_iface::m_add_timer,
+                               when,
+                               task_clock::duration::zero(),
+                               std::ref(task));
+    return result;
+}
+
+task_scheduler_iface::timer_id
+task_scheduler_iface::add_periodic_task(task_clock::duration period, task_base::ptr task)
+{
+    timer_id result = 0;
+    task_scheduler_bus::invoke(result,
+                               &task_scheduler_iface::m_add_timer,
+                               now() + period,
+                               period,
+                               std::ref(task));
+    return result;
+}
+
+bool
+task_scheduler_iface::cancel_timer(timer_id id)
+{
+    bool result = false;
+    task_scheduler_bus::invoke(result, &task_scheduler_iface::m_cancel_timer, id);
+    return result;
+}
+
+task_clock::time_point
+task_scheduler_iface::now()
+{
+    task_clock::time_point result = task_clock::now();
+    task_scheduler_bus::invoke(result, &task_scheduler_iface::m_now);
+    return result;
+}
+
 } // namespace EBUS_NS
 
 namespace EBUS_NS
 {
 
-default_task_scheduler::default_task_scheduler()
+namespace
+{
+
+std::atomic<uint64_t> g_seeds = 0;
+
+// the placement state of the calling thread.
+struct placement_state
+{
+    // set on the workers, for task_placement::submitter_local.
+    const default_task_scheduler* scheduler = nullptr;
+    size_t                        worker    = 0;
+    size_t                        cursor    = 0;
+    uint64_t                      random    = 0;
+
+    // xorshift64*, seeded from a count of the threads, as a thread may get
+    // the state address of one gone before it.
+    uint64_t next()
+    {
+        if (random == 0)
+            random = (g_seeds.fetch_add(1, std::memory_order_relaxed) + 1) *
+                         0x9e3779b97f4a7c15ull |
+                     1;
+        random ^= random >> 12;
+        random ^= random << 25;
+        random ^= random >> 27;
+        return random * 0x2545f4914f6cdd1dull;
+    }
+
+    // starts at a random worker, so short-lived submitters do not all begin
+    // with the first one.
+    size_t advance()
+    {
+        if (cursor == 0)
+            cursor = (size_t)next();
+        return cursor++;
+    }
+};
+
+thread_local placement_state t_placement;
+
+} // namespace
+
+default_task_scheduler::default_task_scheduler(const task_scheduler_config& config) :
+    m_timer_thread_name(config.thread_name.empty() ? "" : config.thread_name + "-timer"),
+    m_epoch(task_clock::now()),
+    m_resolution(std::max(config.timer_resolution, task_clock::duration(1))),
+    m_virtual_clock(config.virtual_clock)
 {
-    handler_t::connect();
+    m_metrics   = config.metrics;
+    m_shutdown  = config.shutdown;
+    m_placement = config.placement;
+
     // get number of workers, minimum is 2, or we have enough
-    size_t nworkers = std::max((unsigned)2, std::thread::hardware_concurrency());
+    size_t nworkers = config.worker_count
+                          ? config.worker_count
+                          : std::max((unsigned)2, std::thread::hardware_concurrency());
+
+    // the nodes with cpus, some only have memory.
+    std::vector<const std::vector<unsigned>*> nodes;
+    for (const auto& node : numa_nodes())
+    {
+        if (!node.empty())
+            nodes.push_back(&node);
+    }
+    m_numa_aware = config.numa_aware && nodes.size() > 1;
+
+    m_workers.resize(nworkers);
+    m_all_workers.resize(nworkers);
+    // the workers report under the lock, the last one may not touch these
+    // once the constructor has seen it and returned.
+    std::mutex              ready_lock;
+    std::condition_variable ready_cv;
+    size_t                  ready = 0;
     // creating the number of threads to schedule for tasks
     for (size_t i = 0; i < nworkers; i++)
     {
-        m_workers.emplace_back(std::unique_ptr<task_worker>(new task_worker));
-        m_worker_threads.emplace_back(std::thread([this, i] { (*m_workers[i])(); }));
+        std::vector<unsigned> cpus;
+        if (!config.cpu_sets.empty())
+            cpus = config.cpu_sets[i % config.cpu_sets.size()];
+        else if (m_numa_aware)
+            cpus = *nodes[i % nodes.size()];
+        int node = cpus.empty() ? 0 : std::max(0, numa_node_of((int)cpus.front()));
+        if (m_node_workers.size() <= (size_t)node)
+            m_node_workers.resize(node + 1);
+        m_node_workers[node].push_back(i);
+        m_all_workers[i] = i;
+
+        std::string name;
+        if (!config.thread_name.empty())
+            name = config.thread_name + "-" + std::to_string(i);
+
+        m_worker_threads.emplace_back(
+            [this, i, cpus = std::move(cpus), name = std::move(name), &ready_lock,
+             &ready_cv, &ready, reserve = config.queue_reserve]
+            {
+                pin_current_thread(cpus);
+                if (!name.empty())
+                    name_current_thread(name);
+                // built and first touched here, on the node of the worker.
+                m_workers[i].reset(new priority_task_worker);
+                m_workers[i]->reserve(reserve);
+                m_workers[i]->set_metrics(m_metrics);
+                t_placement.scheduler = this;
+                t_placement.worker    = i;
+                {
+                    std::scoped_lock<std::mutex> lock(ready_lock);
+                    ready++;
+                    ready_cv.notify_one();
+                }
+                (*m_workers[i])();
+            });
+    }
+    {
+        std::unique_lock<std::mutex> lock(ready_lock);
+        ready_cv.wait(lock, [&ready, nworkers]() { return ready == nworkers; });
+    }
+
+    // only take tasks once every worker is there.
+    if (config.connect)
+    {
+        handler_t::connect();
+        if (m_metrics)
+            metrics_handler_t::connect();
+        m_connected = true;
+    }
+
+    if (m_metrics && config.metrics_period > task_clock::duration::zero())
+    {
+        m_add_timer(m_now() + config.metrics_period,
+                    config.metrics_period,
+                    make_task(
+                        [this]()
+                        {
+                            task_scheduler_metrics metrics = m_snapshot();
+                            task_metrics_report_bus::broadcast(
+                                &task_metrics_report_iface::m_report,
+                                std::cref(metrics));
+                        }));
     }
 }
 
 default_task_scheduler::~default_task_scheduler()
 {
-    // exhaust the workers queues.
-    for (size_t i = 0; i < m_workers.size(); i++)
+    shutdown();
+
+    // now it is good time to disconnect.
+    if (m_connected)
+    {
+        handler_t::disconnect();
+        metrics_handler_t::disconnect();
+    }
+}
+
+const task_shutdown_report&
+default_task_scheduler::shutdown(const task_shutdown_options& options)
+{
+    if (m_stopped)
+        return m_report;
+    m_stopped = true;
+
+    auto start = task_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_report_lock);
+        if (options.timeout < task_clock::time_point::max() - start)
+            m_stop_deadline = start + options.timeout;
+        m_shutdown = options;
+    }
+    m_stopping.store(true, std::memory_order_release);
+
+    // pending timers are dropped.
+    size_t timers;
     {
-        m_workers[i]->shutdown();
+        std::lock_guard<std::mutex> lock(m_timer_lock);
+        m_timer_stop = true;
+        timers       = m_timers.size();
     }
+    m_timer_cv.notify_one();
+    if (m_timer_thread.joinable())
+        m_timer_thread.join();
 
-    // now it is good time to disconnect and join all the threads.
-    handler_t::disconnect();
+    // every worker drains its own queue, in parallel.
+    for (size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i]->stop(m_stop_deadline, options.policy);
+    }
     for (size_t i = 0; i < m_worker_threads.size(); i++)
     {
         m_worker_threads[i].join();
     }
+
+    // a task may have slipped in while its worker was stopping.
+    for (size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i]->drain();
+    }
+
+    std::lock_guard<std::mutex> lock(m_report_lock);
+    for (size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_report.merge(m_workers[i]->shutdown_report());
+    }
+    m_report.timers = timers;
+    m_report.took   = task_clock::now() - start;
+    return m_report;
 }
 
 void
 default_task_scheduler::m_add_task(task_base::ptr task)
 {
-    // find the worker with least amount of work
-    task_worker* idle_worker = nullptr;
-    for (auto& worker : m_workers)
+    // taken by another connected scheduler, see task_scheduler_config::connect.
+    if (!task)
+        return;
+
+    priority_task_worker* worker = m_workers[place(candidates())].get();
+
+    // all the workers are shutting down, a chained task done by the last
+    // worker still wants its next step to run, we exhaust it here like the
+    // workers exhaust their queues.
+    if (!worker->add_task(std::move(task)))
+    {
+        retire(task);
+    }
+}
+
+void
+default_task_scheduler::m_add_tasks(std::span<task_base::ptr> tasks)
+{
+    size_t first = 0;
+    if (m_placement == task_placement::submitter_local && t_placement.scheduler == this)
+    {
+        if (m_workers[t_placement.worker]->add_tasks(tasks))
+            first = tasks.size();
+    }
+    else
+    {
+        // read every worker's depth once, then fill the workers up to the
+        // same level so each worker gets a single contiguous chunk, one lock
+        // and one wake up, whatever the placement.
+        const std::vector<size_t>& workers = candidates();
+        std::vector<size_t>        loads(workers.size());
+        size_t                     total = tasks.size();
+        for (size_t i = 0; i < workers.size(); i++)
+        {
+            loads[i] = m_workers[workers[i]]->depth();
+            total += loads[i];
+        }
+
+        size_t level = (total + workers.size() - 1) / workers.size();
+        for (size_t i = 0; i < workers.size() && first < tasks.size(); i++)
+        {
+            if (loads[i] >= level)
+                continue;
+            size_t count = std::min(level - loads[i], tasks.size() - first);
+            if (m_workers[workers[i]]->add_tasks(tasks.subspan(first, count)))
+                first += count;
+        }
+    }
+
+    // the workers are shutting down, see m_add_task.
+    for (; first < tasks.size(); first++)
+    {
+        retire(tasks[first]);
+        tasks[first].reset();
+    }
+}
+
+const std::vector<size_t>&
+default_task_scheduler::candidates() const
+{
+    if (m_numa_aware)
+    {
+        int node = numa_node_of(current_cpu());
+        if (node >= 0 && (size_t)node < m_node_workers.size() &&
+            !m_node_workers[node].empty())
+            return m_node_workers[node];
+    }
+    return m_all_workers;
+}
+
+size_t
+default_task_scheduler::place(const std::vector<size_t>& workers) const
+{
+    size_t n = workers.size();
+    switch (m_placement)
+    {
+    case task_placement::least_loaded:
     {
-        // skip if not live.
-        if (!worker->live())
-            continue;
-        if (!idle_worker || (worker->size() < idle_worker->size()))
-            idle_worker = worker.get();
+        size_t best = 0;
+        size_t load = m_workers[workers[0]]->depth();
+        for (size_t i = 1; i < n && load > 0; i++)
+        {
+            size_t depth = m_workers[workers[i]]->depth();
+            if (depth < load)
+            {
+                best = i;
+                load = depth;
+            }
+        }
+        return workers[best];
     }
+    case task_placement::round_robin:
+        return workers[t_placement.advance() % n];
+    case task_placement::submitter_local:
+        if (t_placement.scheduler == this)
+            return t_placement.worker;
+        [[fallthrough]];
+    case task_placement::power_of_two:
+    default:
+    {
+        if (n == 1)
+            return workers[0];
+        uint64_t r = t_placement.next();
+        size_t   a = (size_t)(r % n);
+        size_t   b = (size_t)((r >> 32) % (n - 1));
+        if (b >= a)
+            b++;
+        return m_workers[workers[b]]->depth() < m_workers[workers[a]]->depth()
+                   ? workers[b]
+                   : workers[a];
+    }
+    }
+}
+
+void
+default_task_scheduler::retire(task_base::ptr& task)
+{
+    if (!m_stopping.load(std::memory_order_acquire))
+    {
+        task->run();
+        return;
+    }
+    // counted, but not run under the lock, the task may add more.
+    task_clock::time_point deadline;
+    shutdown_policy        policy;
+    {
+        std::lock_guard<std::mutex> lock(m_report_lock);
+        deadline = m_stop_deadline;
+        policy   = m_shutdown.policy;
+    }
+    task_shutdown_report report;
+    report.retire(task, deadline, policy);
+
+    std::lock_guard<std::mutex> lock(m_report_lock);
+    m_report.merge(report);
+}
 
-    idle_worker->add_task(task);
+task_scheduler_metrics
+default_task_scheduler::m_snapshot()
+{
+    task_scheduler_metrics result;
+    result.workers.reserve(m_workers.size());
+    for (auto& worker : m_workers)
+    {
+        result.workers.push_back(worker->metrics());
+    }
+    return result;
 }
 
 rescheduable_task::ptr
@@ -186,4 +632,112 @@ default_task_scheduler::m_add_rescheduable_task(const task_base::exec_fn& fn)
     return new_task;
 }
 
+uint64_t
+default_task_scheduler::to_tick(task_clock::time_point when) const
+{
+    if (when <= m_epoch)
+        return 0;
+    // rounded up, a timer never fires early.
+    return (uint64_t)((when - m_epoch + m_resolution - task_clock::duration(1)) /
+                      m_resolution);
+}
+
+task_clock::time_point
+default_task_scheduler::m_now()
+{
+    if (!m_virtual_clock)
+        return task_clock::now();
+    std::lock_guard<std::mutex> lock(m_timer_lock);
+    return m_epoch + m_virtual_now;
+}
+
+task_scheduler_iface::timer_id
+default_task_scheduler::m_add_timer(task_clock::time_point when,
+                                    task_clock::duration   period,
+                                    task_base::ptr         task)
+{
+    uint64_t expiry = to_tick(when);
+    uint64_t ticks  = 0;
+    if (period > task_clock::duration::zero())
+        ticks = std::max<uint64_t>(1, (uint64_t)(period / m_resolution));
+
+    timer_id id;
+    bool     wake = false;
+    {
+        std::lock_guard<std::mutex> lock(m_timer_lock);
+        if (m_timer_stop)
+            return 0;
+        id = m_timers.add(expiry, std::move(task), ticks);
+        if (!m_virtual_clock && !m_timer_thread.joinable())
+        {
+            m_timer_wake   = expiry;
+            m_timer_thread = std::thread([this] { timer_loop(); });
+        }
+        else if (expiry < m_timer_wake)
+        {
+            // the timer thread sleeps past this one.
+            m_timer_wake = expiry;
+            wake         = true;
+        }
+    }
+    if (wake)
+        m_timer_cv.notify_one();
+    return id;
+}
+
+bool
+default_task_scheduler::m_cancel_timer(timer_id id)
+{
+    std::lock_guard<std::mutex> lock(m_timer_lock);
+    return m_timers.cancel(id);
+}
+
+void
+default_task_scheduler::advance_clock(task_clock::duration by)
+{
+    assert(m_virtual_clock && "advance_clock() needs a virtual clock");
+
+    std::vector<task_base::ptr> due;
+    auto collect = [&due](task_base::ptr task) { due.push_back(std::move(task)); };
+    {
+        std::lock_guard<std::mutex> lock(m_timer_lock);
+        m_virtual_now += by;
+        // the tick we are past, not the next one.
+        m_timers.advance((uint64_t)(m_virtual_now / m_resolution), collect);
+    }
+    if (!due.empty())
+        m_add_tasks(due);
+}
+
+void
+default_task_scheduler::timer_loop()
+{
+    if (!m_timer_thread_name.empty())
+        name_current_thread(m_timer_thread_name);
+
+    // reused, the due tasks are handed to the workers out of the lock.
+    std::vector<task_base::ptr>  due;
+    auto collect = [&due](task_base::ptr task) { due.push_back(std::move(task)); };
+    std::unique_lock<std::mutex> lock(m_timer_lock);
+    while (!m_timer_stop)
+    {
+        uint64_t now = (uint64_t)((task_clock::now() - m_epoch) / m_resolution);
+        m_timers.advance(now, collect);
+        m_timer_wake = m_timers.next_expiry();
+        if (!due.empty())
+        {
+            lock.unlock();
+            m_add_tasks(due);
+            due.clear();
+            lock.lock();
+            continue; // timers may have come due meanwhile
+        }
+
+        if (m_timer_wake == std::numeric_limits<uint64_t>::max())
+            m_timer_cv.wait(lock);
+        else
+            m_timer_cv.wait_until(lock, m_epoch + m_resolution * m_timer_wake);
+    }
+}
+
 } // namespace EBUS_NS
@@ -1,62 +1,268 @@
 #include "ebus/task_worker.hh"
+#include "ebus/memory/cpu_relax.hh"
+
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <thread>
 
 namespace EBUS_NS
 {
 
 void
-task_worker::shutdown()
+task_shutdown_report::retire(task_base::ptr&        task,
+                             task_clock::time_point deadline,
+                             shutdown_policy        policy)
+{
+    if (deadline == task_clock::time_point::max() || task_clock::now() < deadline)
+    {
+        task->run();
+        ran++;
+        return;
+    }
+
+    discarded[(size_t)task->m_priority]++;
+    if (policy == shutdown_policy::cancel)
+    {
+        task->task_cancelled();
+        cancelled++;
+    }
+    else
+    {
+        dropped++;
+    }
+}
+
+void
+task_shutdown_report::merge(const task_shutdown_report& other)
+{
+    ran += other.ran;
+    cancelled += other.cancelled;
+    dropped += other.dropped;
+    timers += other.timers;
+    for (size_t i = 0; i < discarded.size(); i++)
+    {
+        discarded[i] += other.discarded[i];
+    }
+}
+
+template <class queue_t>
+void
+basic_task_worker<queue_t>::shutdown()
 {
     m_live.store(false);
     // time to exhaust the queue, because the worker is no longer in live mode,
     // it is not possible add_task anymore. We are sure we can exhaust the
-    // queue this time.
-    while (m_tasks.size() > 0)
+    // queue this time. try_pop() because the worker thread may take the last
+    // task right under our nose.
+    task_base::ptr task;
+    while (m_tasks.try_pop(task))
     {
-        auto task = m_tasks.pop();
+        taken(1);
         if (task)
         {
-            task->exec();
-            task->task_done();
+            task->run();
         }
     }
     // the special code to trick the task_worker thread to quit
     // waiting. Because it is possible the worker thread was waiting the empty queue
+    pushed(1);
     m_tasks.push(INTRUSIVE_NS::intrusive_ptr<task_base>{});
 }
 
+template <class queue_t>
 void
-task_worker::operator()()
+basic_task_worker<queue_t>::stop(task_clock::time_point deadline, shutdown_policy policy)
 {
+    m_stop_deadline = deadline;
+    m_stop_policy   = policy;
+    m_live.store(false);
+    // wakes the worker up, it drains the queue once out of its loop.
+    pushed(1);
+    m_tasks.push(INTRUSIVE_NS::intrusive_ptr<task_base>{});
+}
+
+template <class queue_t>
+void
+basic_task_worker<queue_t>::drain()
+{
+    task_base::ptr task;
+    while (m_tasks.try_pop(task))
+    {
+        taken(1);
+        if (task)
+            m_report.retire(task, m_stop_deadline, m_stop_policy);
+        task.reset();
+    }
+}
+
+template <class queue_t>
+void
+basic_task_worker<queue_t>::operator()()
+{
+    std::array<task_base::ptr, drain_batch> batch;
     while (m_live)
     {
-        auto task = m_tasks.pop();
+        size_t n = try_acquire(batch.data(), batch.size());
+        if (n == 0)
+        {
+            m_parks.store(m_parks.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+            batch[0] = m_tasks.pop();
+            n        = 1;
+        }
+        taken(n);
 
-        if (task) // if we come from shutdown, the task is empty here.
+        for (size_t i = 0; i < n; i++)
         {
-            task->exec();
-            task->task_done();
+            if (batch[i]) // if we come from shutdown, the task is empty here.
+            {
+                // stopped meanwhile, the rest of the batch is drained.
+                if (m_live)
+                    run(batch[i]);
+                else
+                    m_report.retire(batch[i], m_stop_deadline, m_stop_policy);
+                batch[i].reset();
+            }
         }
     }
+    drain();
 }
 
+template <class queue_t>
+size_t
+basic_task_worker<queue_t>::try_acquire(task_base::ptr* tasks, size_t max)
+{
+    size_t n = 0;
+    for (unsigned i = 0; i < m_idle.spin_count; i++)
+    {
+        if ((n = m_tasks.pop_n(tasks, max)) > 0)
+            return n;
+        cpu_relax();
+    }
+    for (unsigned i = 0; i < m_idle.yield_count; i++)
+    {
+        if ((n = m_tasks.pop_n(tasks, max)) > 0)
+            return n;
+        std::this_thread::yield();
+    }
+    return m_tasks.pop_n(tasks, max);
+}
+
+template <class queue_t>
+void
+basic_task_worker<queue_t>::run(task_base::ptr& task)
+{
+    if (m_metrics_on)
+    {
+        auto start  = task_clock::now();
+        auto queued = task_clock::time_point(
+            task_clock::duration(task->m_queued.load(std::memory_order_relaxed)));
+        m_wait.record(start - queued);
+        task->run();
+        auto took = task_clock::now() - start;
+        m_run.record(took);
+        m_busy.store(m_busy.load(std::memory_order_relaxed) + (uint64_t)took.count(),
+                     std::memory_order_relaxed);
+    }
+    else
+    {
+        task->run();
+    }
+    m_executed.store(m_executed.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+}
+
+template <class queue_t>
+bool
+basic_task_worker<queue_t>::add_task(const task_base::ptr& task)
+{
+    return add_task(task_base::ptr(task));
+}
+
+template <class queue_t>
+bool
+basic_task_worker<queue_t>::add_task(task_base::ptr&& task)
+{
+    if (!this->live())
+    {
+        return false;
+    }
+
+    if (m_metrics_on)
+        task->m_queued.store(task_clock::now().time_since_epoch().count(),
+                             std::memory_order_relaxed);
+    pushed(1);
+    m_tasks.push(std::move(task));
+    return true;
+}
+
+template <class queue_t>
 bool
-task_worker::add_task(intrusive_ptr<task_base> task)
+basic_task_worker<queue_t>::add_tasks(std::span<task_base::ptr> tasks)
 {
     if (!this->live())
     {
         return false;
     }
 
-    m_tasks.push(task);
+    if (m_metrics_on)
+    {
+        auto now = task_clock::now().time_since_epoch().count();
+        for (task_base::ptr& task : tasks)
+        {
+            task->m_queued.store(now, std::memory_order_relaxed);
+        }
+    }
+    pushed(tasks.size());
+    m_tasks.push_n(tasks.begin(), tasks.end());
     return true;
 }
 
+template <class queue_t>
 bool
-task_worker::live() const
+basic_task_worker<queue_t>::live() const
 {
     bool value = m_live.load();
     return value;
 }
 
+template <class queue_t>
+void
+basic_task_worker<queue_t>::set_idle_strategy(const idle_strategy& strategy)
+{
+    m_idle = strategy;
+}
+
+template <class queue_t>
+task_worker_stats
+basic_task_worker<queue_t>::stats()
+{
+    task_worker_stats result;
+    result.executed = m_executed.load(std::memory_order_relaxed);
+    result.parks    = m_parks.load(std::memory_order_relaxed);
+    result.wakeups  = m_tasks.wakeups();
+    return result;
+}
+
+template <class queue_t>
+task_worker_metrics
+basic_task_worker<queue_t>::metrics()
+{
+    task_worker_metrics result;
+    result.queue_depth = m_tasks.size();
+    result.executed    = m_executed.load(std::memory_order_relaxed);
+    result.wait        = m_wait.snapshot();
+    result.run         = m_run.snapshot();
+    result.busy        = task_clock::duration(
+        (task_clock::rep)m_busy.load(std::memory_order_relaxed));
+    result.idle = std::max(task_clock::now() - m_started - result.busy,
+                           task_clock::duration::zero());
+    return result;
+}
+
+template class basic_task_worker<safe_queue<task_base::ptr>>;
+template class basic_task_worker<blocking_queue<mpmc_queue<task_base::ptr>>>;
+template class basic_task_worker<safe_queue<task_base::ptr, task_lanes>>;
+
 } // namespace EBUS_NS
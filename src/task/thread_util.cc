@@ -0,0 +1,171 @@
+#include "thread_util.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+#if defined(_WIN32)
+#    include <windows.h>
+#elif defined(__linux__)
+#    include <pthread.h>
+#    include <sched.h>
+#elif defined(__APPLE__)
+#    include <pthread.h>
+#endif
+
+namespace EBUS_NS
+{
+
+namespace
+{
+
+// parses the sysfs list format, like "0-3,8,10-11".
+std::vector<unsigned>
+parse_cpu_list(const std::string& list)
+{
+    std::vector<unsigned> cpus;
+    size_t                pos = 0;
+    while (pos < list.size())
+    {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string range = list.substr(pos, end - pos);
+        size_t      dash  = range.find('-');
+        try
+        {
+            unsigned first = (unsigned)std::stoul(range.substr(0, dash));
+            unsigned last  = first;
+            if (dash != std::string::npos)
+                last = (unsigned)std::stoul(range.substr(dash + 1));
+            for (unsigned cpu = first; cpu <= last; cpu++)
+                cpus.push_back(cpu);
+        }
+        catch (...)
+        {
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+std::vector<std::vector<unsigned>>
+detect_numa_nodes()
+{
+    std::vector<std::vector<unsigned>> nodes;
+#if defined(__linux__)
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string   list;
+    if (online && std::getline(online, list))
+    {
+        for (unsigned node : parse_cpu_list(list))
+        {
+            std::ifstream cpulist("/sys/devices/system/node/node" +
+                                  std::to_string(node) + "/cpulist");
+            std::string   cpus;
+            if (node >= nodes.size())
+                nodes.resize(node + 1);
+            if (cpulist && std::getline(cpulist, cpus))
+                nodes[node] = parse_cpu_list(cpus);
+        }
+    }
+#endif
+    if (nodes.empty())
+    {
+        unsigned ncpus = std::max(1u, std::thread::hardware_concurrency());
+        nodes.emplace_back();
+        for (unsigned cpu = 0; cpu < ncpus; cpu++)
+            nodes[0].push_back(cpu);
+    }
+    return nodes;
+}
+
+} // namespace
+
+bool
+pin_current_thread(std::span<const unsigned> cpus)
+{
+    if (cpus.empty())
+        return false;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    // a thread only gets a mask within its processor group.
+    DWORD_PTR mask = 0;
+    for (unsigned cpu : cpus)
+    {
+        if (cpu < sizeof(DWORD_PTR) * 8)
+            mask |= (DWORD_PTR)1 << cpu;
+    }
+    return mask && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    // macOS only has affinity hints, no pinning.
+    return false;
+#endif
+}
+
+void
+name_current_thread(const std::string& name)
+{
+#if defined(__linux__)
+    // 16 bytes including the terminator.
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#elif defined(__APPLE__)
+    pthread_setname_np(name.substr(0, 63).c_str());
+#elif defined(_WIN32)
+    std::wstring wide(name.begin(), name.end());
+    SetThreadDescription(GetCurrentThread(), wide.c_str());
+#else
+    (void)name;
+#endif
+}
+
+int
+current_cpu()
+{
+#if defined(__linux__)
+    return sched_getcpu();
+#elif defined(_WIN32)
+    return (int)GetCurrentProcessorNumber();
+#else
+    return -1;
+#endif
+}
+
+const std::vector<std::vector<unsigned>>&
+numa_nodes()
+{
+    static const std::vector<std::vector<unsigned>> nodes = detect_numa_nodes();
+    return nodes;
+}
+
+int
+numa_node_of(int cpu)
+{
+    // called on every submission, a lookup table.
+    static const std::vector<int> cpu_nodes = []()
+    {
+        std::vector<int> result;
+        const auto&      nodes = numa_nodes();
+        for (size_t node = 0; node < nodes.size(); node++)
+        {
+            for (unsigned c : nodes[node])
+            {
+                if (c >= result.size())
+                    result.resize(c + 1, 0);
+                result[c] = (int)node;
+            }
+        }
+        return result;
+    }();
+    return cpu >= 0 && (size_t)cpu < cpu_nodes.size() ? cpu_nodes[cpu] : 0;
+}
+
+} // namespace EBUS_NS
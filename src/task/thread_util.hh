@@ -0,0 +1,28 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+/// @brief pins the calling thread to the given cpus, returns false when the
+/// platform does not support it or refused.
+bool pin_current_thread(std::span<const unsigned> cpus);
+
+/// @brief names the calling thread for debuggers and profilers, truncated to
+/// what the platform takes.
+void name_current_thread(const std::string& name);
+
+/// @brief the cpu the calling thread runs on, -1 if unknown.
+int current_cpu();
+
+/// @brief the cpus of each NUMA node, indexed by node. A single node holding
+/// every cpu if the platform has no NUMA information.
+const std::vector<std::vector<unsigned>>& numa_nodes();
+
+/// @brief the NUMA node of a cpu, 0 if unknown.
+int numa_node_of(int cpu);
+
+} // namespace EBUS_NS
@@ -0,0 +1,275 @@
+#include <ebus/topic_bus.hh>
+
+#include <algorithm>
+#include <assert.h>
+#include <mutex>
+#include <unordered_map>
+
+namespace EBUS_NS
+{
+
+struct topic_index::node
+{
+    std::unordered_map<std::string, std::unique_ptr<node>> m_children;
+    std::unique_ptr<node>                                   m_any;  // "*"
+    subscribers_t                                           m_here; // ends here
+    subscribers_t                                           m_rest; // "**"
+};
+
+// open addressing, the entries by id. Filled under the lock, at most half,
+// read without it.
+struct topic_index::table
+{
+    explicit table(size_t capacity) :
+        m_mask(capacity - 1),
+        m_slots(new std::atomic<entry*>[capacity]())
+    {
+    }
+
+    entry* find(uint64_t id) const
+    {
+        for (size_t i = id & m_mask;; i = (i + 1) & m_mask)
+        {
+            entry* at = m_slots[i].load(std::memory_order_acquire);
+            if (!at || at->m_id == id)
+                return at;
+        }
+    }
+
+    void insert(entry* interned)
+    {
+        size_t i = interned->m_id & m_mask;
+        while (m_slots[i].load(std::memory_order_relaxed))
+        {
+            i = (i + 1) & m_mask;
+        }
+        m_slots[i].store(interned, std::memory_order_release);
+    }
+
+    const size_t                           m_mask;
+    std::unique_ptr<std::atomic<entry*>[]> m_slots;
+};
+
+namespace
+{
+
+// the next segment of a name, consumed from it.
+std::string_view
+next_segment(std::string_view& name)
+{
+    size_t           dot     = name.find('.');
+    std::string_view segment = name.substr(0, dot);
+    name = dot == std::string_view::npos ? std::string_view() : name.substr(dot + 1);
+    return segment;
+}
+
+void
+add_unique(topic_index::subscribers_t& subscribers, topic_subscriber* subscriber)
+{
+    auto end = subscribers.end();
+    if (std::find(subscribers.begin(), end, subscriber) == end)
+        subscribers.push_back(subscriber);
+}
+
+void
+add_all(topic_index::subscribers_t& subscribers, const topic_index::subscribers_t& from)
+{
+    for (topic_subscriber* subscriber : from)
+    {
+        add_unique(subscribers, subscriber);
+    }
+}
+
+topic_index::snapshot_t
+snapshot(topic_index::subscribers_t&& subscribers)
+{
+    return std::make_shared<const topic_index::subscribers_t>(std::move(subscribers));
+}
+
+bool
+contains(const topic_index::subscribers_t& subscribers, topic_subscriber* subscriber)
+{
+    return std::find(subscribers.begin(), subscribers.end(), subscriber) !=
+           subscribers.end();
+}
+
+} // namespace
+
+topic_index::topic_index() :
+    m_root(std::make_unique<node>())
+{
+    m_tables.push_back(std::make_unique<table>(64));
+    m_table.store(m_tables.back().get(), std::memory_order_release);
+}
+
+topic_index::~topic_index() = default;
+
+bool
+topic_index::match(std::string_view pattern, std::string_view name)
+{
+    while (!pattern.empty())
+    {
+        std::string_view expected = next_segment(pattern);
+        if (expected == "**")
+            return true;
+        if (name.empty())
+            return false;
+        std::string_view segment = next_segment(name);
+        if (expected != "*" && expected != segment)
+            return false;
+    }
+    return name.empty();
+}
+
+topic_index::snapshot_t
+topic_index::subscribers(const topic& t)
+{
+    entry* found = m_table.load(std::memory_order_acquire)->find(t.id);
+    if (!found) [[unlikely]]
+    {
+        std::scoped_lock<std::mutex> lock(m_lock);
+        found = &intern(t.name);
+    }
+    return found->m_subscribers.load(std::memory_order_acquire);
+}
+
+topic
+topic_index::intern_topic(std::string_view name)
+{
+    std::scoped_lock<std::mutex> lock(m_lock);
+    return topic(std::string_view(intern(name).m_name));
+}
+
+topic_index::entry&
+topic_index::intern(std::string_view name)
+{
+    uint64_t id    = fnv1a(name);
+    entry*   found = m_tables.back()->find(id);
+    if (found)
+    {
+        assert(found->m_name == name && "two topic names hash the same");
+        return *found;
+    }
+
+    m_topics.push_back(std::make_unique<entry>(id, std::string(name)));
+    entry&        interned = *m_topics.back();
+    subscribers_t subscribers;
+
+    // every pattern matching the name, walking the trie one segment a step.
+    std::vector<const node*> level = {m_root.get()}, next;
+    std::string_view         rest  = name;
+    while (!level.empty())
+    {
+        bool             last    = rest.empty();
+        std::string_view segment = next_segment(rest);
+        next.clear();
+        for (const node* at : level)
+        {
+            add_all(subscribers, at->m_rest);
+            if (last)
+            {
+                add_all(subscribers, at->m_here);
+                continue;
+            }
+            auto child = at->m_children.find(std::string(segment));
+            if (child != at->m_children.end())
+                next.push_back(child->second.get());
+            if (at->m_any)
+                next.push_back(at->m_any.get());
+        }
+        level.swap(next);
+    }
+    interned.m_subscribers.store(snapshot(std::move(subscribers)),
+                                 std::memory_order_relaxed);
+
+    // a larger table replaces a half full one, the old one may still be read.
+    table* last = m_tables.back().get();
+    if (m_topics.size() * 2 > last->m_mask + 1)
+    {
+        m_tables.push_back(std::make_unique<table>((last->m_mask + 1) * 2));
+        last = m_tables.back().get();
+        for (const std::unique_ptr<entry>& at : m_topics)
+        {
+            last->insert(at.get());
+        }
+        m_table.store(last, std::memory_order_release);
+    }
+    else
+        last->insert(&interned);
+    return interned;
+}
+
+bool
+topic_index::subscribe(std::string_view pattern, topic_subscriber* subscriber)
+{
+    std::string_view rest = pattern;
+    while (!rest.empty())
+    {
+        if (next_segment(rest) == "**" && !rest.empty())
+            return false; // only allowed last
+    }
+
+    std::scoped_lock<std::mutex> lock(m_lock);
+
+    node* at = m_root.get();
+    rest     = pattern;
+    while (!rest.empty())
+    {
+        std::string_view segment = next_segment(rest);
+        if (segment == "**")
+            break;
+        std::unique_ptr<node>& child =
+            segment == "*" ? at->m_any : at->m_children[std::string(segment)];
+        if (!child)
+            child = std::make_unique<node>();
+        at = child.get();
+    }
+    bool rest_of = pattern == "**" || pattern.ends_with(".**");
+    add_unique(rest_of ? at->m_rest : at->m_here, subscriber);
+
+    // the topics interned already, their lists replaced.
+    for (const std::unique_ptr<entry>& interned : m_topics)
+    {
+        snapshot_t current = interned->m_subscribers.load(std::memory_order_relaxed);
+        if (!match(pattern, interned->m_name) || contains(*current, subscriber))
+            continue;
+        subscribers_t subscribers = *current;
+        subscribers.push_back(subscriber);
+        interned->m_subscribers.store(snapshot(std::move(subscribers)),
+                                      std::memory_order_release);
+    }
+    return true;
+}
+
+void
+topic_index::unsubscribe(topic_subscriber* subscriber)
+{
+    std::scoped_lock<std::mutex> lock(m_lock);
+
+    std::vector<node*> pending = {m_root.get()};
+    while (!pending.empty())
+    {
+        node* at = pending.back();
+        pending.pop_back();
+        std::erase(at->m_here, subscriber);
+        std::erase(at->m_rest, subscriber);
+        for (auto& [segment, child] : at->m_children)
+        {
+            pending.push_back(child.get());
+        }
+        if (at->m_any)
+            pending.push_back(at->m_any.get());
+    }
+    for (const std::unique_ptr<entry>& interned : m_topics)
+    {
+        snapshot_t current = interned->m_subscribers.load(std::memory_order_relaxed);
+        if (!contains(*current, subscriber))
+            continue;
+        subscribers_t subscribers = *current;
+        std::erase(subscribers, subscriber);
+        interned->m_subscribers.store(snapshot(std::move(subscribers)),
+                                      std::memory_order_release);
+    }
+}
+
+} // namespace EBUS_NS
@@ -0,0 +1,109 @@
+#include <ebus/affinity_queue.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+bool
+test_continuations()
+{
+    const int        ntasks      = 200;
+    std::atomic<int> off_thread  = 0;
+    int              on_thread   = 0; // only touched by this thread
+    std::thread::id  main_thread = std::this_thread::get_id();
+    affinity_queue   main_queue("main");
+    {
+        default_task_scheduler scheduler;
+        for (int i = 0; i < ntasks; i++)
+        {
+            task_scheduler_iface::add_task(make_task(
+                [&]()
+                {
+                    off_thread += std::this_thread::get_id() != main_thread;
+                    // hand the continuation back.
+                    task_scheduler_iface::add_task(
+                        affinity_tag_of("main"),
+                        make_task(
+                            [&]()
+                            {
+                                bool here = std::this_thread::get_id() == main_thread;
+                                on_thread += here;
+                            }));
+                }));
+        }
+        while (on_thread < ntasks)
+        {
+            main_queue.run_pending(size_t(16));
+            std::this_thread::yield();
+        }
+    }
+    return on_thread == ntasks && off_thread == ntasks && main_queue.size() == 0;
+}
+
+bool
+test_budget()
+{
+    affinity_queue   queue("budget");
+    std::vector<int> order;
+    for (int i = 0; i < 20; i++)
+    {
+        task_scheduler_iface::add_task(queue.tag(),
+                                       make_task(
+                                           [&order, i]()
+                                           {
+                                               std::this_thread::sleep_for(
+                                                   std::chrono::milliseconds(1));
+                                               order.push_back(i);
+                                           }));
+    }
+    if (queue.run_pending(size_t(3)) != 3)
+        return false;
+    size_t ran = queue.run_pending(std::chrono::milliseconds(5));
+    if (ran < 1 || ran >= 17)
+        return false;
+    queue.run_pending();
+    for (int i = 0; i < 20; i++)
+    {
+        if (order[i] != i)
+            return false;
+    }
+    return queue.size() == 0;
+}
+
+bool
+test_overflow()
+{
+    affinity_queue queue("overflow", 4);
+    affinity_queue twin("overflow");
+    int            sum = 0;
+    if (twin.connected() || !queue.connected())
+        return false;
+    if (task_scheduler_iface::add_task(affinity_tag_of("nobody"), make_task([]() {})))
+        return false;
+
+    for (int i = 1; i <= 10; i++)
+    {
+        task_scheduler_iface::add_task(affinity_tag_of("overflow"),
+                                       make_task([&sum, i]() { sum = sum * 2 + i; }));
+    }
+    if (queue.size() != 10 || queue.run_pending() != 10)
+        return false;
+    // in submission order.
+    int expect = 0;
+    for (int i = 1; i <= 10; i++)
+        expect = expect * 2 + i;
+    return sum == expect;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test affinity queue [TASK]")
+{
+    REQUIRE(EBUS_NS::test_continuations() == true);
+    REQUIRE(EBUS_NS::test_budget() == true);
+    REQUIRE(EBUS_NS::test_overflow() == true);
+}
@@ -0,0 +1,212 @@
+#include <ebus/ipc/bus_recorder.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#    include <unistd.h>
+#endif
+
+namespace EBUS_NS
+{
+
+struct sensor_iface : public ebus_iface<ebus_type::GLOBAL>
+{
+    virtual void sample(int channel, double value) = 0;
+    virtual void ignored(int)                      = 0;
+};
+
+using sensor_marshal = bus_marshal<sensor_iface, &sensor_iface::sample>;
+EBUS_TAP(sensor_marshal);
+
+struct sensor_handler : public ebus_handler<sensor_iface>
+{
+    sensor_handler() { connect(); }
+
+    void sample(int channel, double value) override
+    {
+        m_samples++;
+        m_channels += channel;
+        m_sum      += value;
+    }
+    void ignored(int) override { m_ignored++; }
+
+    std::atomic<int> m_samples  = 0;
+    std::atomic<int> m_channels = 0;
+    double           m_sum      = 0; // summed by a single thread
+    int              m_ignored  = 0;
+};
+
+struct key_iface : public ebus_iface<ebus_type::GLOBAL>
+{
+    virtual bool key(int code) = 0;
+};
+
+using key_marshal = bus_marshal<key_iface, &key_iface::key>;
+EBUS_TAP(key_marshal);
+
+struct key_layer : public ebus_handler<key_iface>
+{
+    key_layer(float priority, int consumed_key) :
+        m_consumed_key(consumed_key)
+    {
+        connect(ebus_priority_t(priority));
+    }
+
+    bool key(int code) override
+    {
+        m_keys++;
+        return code == m_consumed_key;
+    }
+
+    const int m_consumed_key;
+    int       m_keys = 0;
+};
+
+std::string
+log_path(const char* test)
+{
+#if !defined(_WIN32)
+    return std::string("/tmp/ebus-") + test + "-" + std::to_string(getpid()) + ".log";
+#else
+    return test;
+#endif
+}
+
+// untapped interfaces are not recorded.
+static_assert(!ebus_tapped<event_base>);
+
+#if !defined(_WIN32)
+
+// threads record, the replay dispatches everything but the unlisted method.
+bool
+test_record_replay()
+{
+    const int   nthreads = 4, nsamples = 1000;
+    std::string path = log_path("replay");
+    event<int>  frame;
+    {
+        bus_recorder recorder(path, 1 << 14);
+        if (!recorder.valid())
+            return false;
+        recorder.track(frame, "frame");
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nthreads; t++)
+        {
+            threads.emplace_back(
+                [t]()
+                {
+                    for (int i = 0; i < nsamples; i++)
+                    {
+                        ebus<sensor_iface>::broadcast(&sensor_iface::sample, t, 0.5);
+                    }
+                });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        ebus<sensor_iface>::broadcast(&sensor_iface::ignored, 1);
+        frame.dispatch(7);
+        frame.dispatch(8);
+        recorder.stop();
+        if (recorder.recorded() != nthreads * nsamples + 2 || recorder.dropped() != 0)
+            return false;
+    }
+
+    sensor_handler handler;
+    int            frames = 0;
+    event<int>     replayed;
+    event<int>::handler on_frame([&frames](int f) { frames += f; }, &replayed);
+
+    bus_replayer replayer(path);
+    replayer.add<sensor_marshal>();
+    replayer.bind(replayed, "frame");
+    bool replayed_all = replayer.valid() && replayer.size() == nthreads * nsamples + 2 &&
+                        replayer.replay() == replayer.size() && replayer.unknown() == 0;
+    std::remove(path.c_str());
+
+    return replayed_all && handler.m_samples == nthreads * nsamples &&
+           handler.m_channels == nsamples * (0 + 1 + 2 + 3) &&
+           handler.m_sum == nthreads * nsamples * 0.5 && handler.m_ignored == 0 &&
+           frames == 15;
+}
+
+// past the capacity records are dropped, the replay keeps the recorded gaps.
+bool
+test_capacity_and_timing()
+{
+    std::string path = log_path("timing");
+    {
+        bus_recorder recorder(path, 2);
+        ebus<sensor_iface>::broadcast(&sensor_iface::sample, 0, 1.0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ebus<sensor_iface>::broadcast(&sensor_iface::sample, 0, 2.0);
+        ebus<sensor_iface>::broadcast(&sensor_iface::sample, 0, 4.0);
+        recorder.stop();
+        if (recorder.recorded() != 2 || recorder.dropped() != 1)
+            return false;
+    }
+
+    // not recorded once stopped.
+    ebus<sensor_iface>::broadcast(&sensor_iface::sample, 0, 8.0);
+
+    sensor_handler handler;
+    bus_replayer   replayer(path);
+    replayer.add<sensor_marshal>();
+    task_clock::time_point start = task_clock::now();
+    size_t                 count = replayer.replay(replay_speed::original);
+    task_clock::duration   took  = task_clock::now() - start;
+    std::remove(path.c_str());
+
+    return count == 2 && handler.m_sum == 3.0 && took >= std::chrono::milliseconds(20);
+}
+
+// an early exit dispatch replays as one, stopping where it stopped.
+bool
+test_record_until()
+{
+    std::string path = log_path("until");
+    {
+        bus_recorder recorder(path, 16);
+        ebus<key_iface>::broadcast_until(&key_iface::key, 27);
+        ebus<key_iface>::broadcast(&key_iface::key, 27);
+        recorder.stop();
+        if (recorder.recorded() != 2)
+            return false;
+    }
+
+    key_layer    modal(10, 27), world(0, -1);
+    bus_replayer replayer(path);
+    replayer.add<key_marshal>();
+    size_t count = replayer.replay();
+    std::remove(path.c_str());
+
+    return count == 2 && replayer.unknown() == 0 && modal.m_keys == 2 &&
+           world.m_keys == 1;
+}
+
+bool
+test_missing()
+{
+    return !bus_replayer(log_path("missing")).valid();
+}
+
+#endif
+
+} // namespace EBUS_NS
+
+#if !defined(_WIN32)
+TEST_CASE("test bus record and replay [IPC]")
+{
+    REQUIRE(EBUS_NS::test_missing() == true);
+    REQUIRE(EBUS_NS::test_record_replay() == true);
+    REQUIRE(EBUS_NS::test_capacity_and_timing() == true);
+    REQUIRE(EBUS_NS::test_record_until() == true);
+}
+#endif
@@ -0,0 +1,124 @@
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <thread>
+
+namespace EBUS_NS
+{
+
+class cancellable_task final : public task_base
+{
+public:
+    cancellable_task(std::atomic<int>& ran, std::atomic<int>& cancelled) :
+        task_base(
+            [&ran]()
+            {
+                ran++;
+                return true;
+            }),
+        m_cancelled(cancelled)
+    {
+    }
+
+    virtual void task_done() override {}
+    virtual void task_cancelled() override { m_cancelled++; }
+    virtual void add_ref() override { ++m_refcount; }
+    virtual void release() override
+    {
+        if (--m_refcount <= 0)
+            delete this;
+    }
+
+private:
+    std::atomic<int>& m_cancelled;
+    std::atomic<int>  m_refcount = 0;
+};
+
+bool
+test_group_cancel()
+{
+    std::atomic<int> ran = 0, cancelled = 0;
+    cancel_token     group = cancel_token::make();
+    task_worker      worker;
+
+    // queued before the worker starts, half of them in the group.
+    for (int i = 0; i < 100; i++)
+    {
+        task_base::ptr task(new cancellable_task(ran, cancelled));
+        if (i % 2 == 0)
+            task->m_cancel = group;
+        worker.add_task(task);
+    }
+    group.cancel();
+
+    std::thread worker_thread([&worker]() { worker(); });
+    while (ran + cancelled < 100)
+        std::this_thread::yield();
+    worker.shutdown();
+    worker_thread.join();
+    return ran == 50 && cancelled == 50 && !cancel_token().cancelled();
+}
+
+bool
+test_chain_cancel()
+{
+    std::atomic<int> steps = 0;
+    bool             fini  = false;
+    cancel_token     token = cancel_token::make();
+    {
+        default_task_scheduler scheduler;
+        task_scheduler_iface::add_rescheduable_task(
+            [&steps, token]()
+            {
+                steps++;
+                // superseded while running.
+                token.cancel();
+                return true;
+            },
+            token)
+            ->reschedule(
+                [&steps]()
+                {
+                    steps++;
+                    return true;
+                })
+            ->finish([&fini]() { fini = true; });
+        while (steps == 0)
+            std::this_thread::yield();
+    }
+    return steps == 1 && !fini;
+}
+
+bool
+test_polling()
+{
+    std::atomic<bool> started = false, stopped = false;
+    cancel_token      token   = cancel_token::make();
+    {
+        default_task_scheduler scheduler;
+        task_scheduler_iface::add_task(make_task(
+            [&, token]()
+            {
+                started = true;
+                while (!token.cancelled())
+                    std::this_thread::yield();
+                stopped = true;
+            }));
+        while (!started)
+            std::this_thread::yield();
+        token.cancel();
+        while (!stopped)
+            std::this_thread::yield();
+    }
+    return stopped;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test task cancellation [TASK]")
+{
+    REQUIRE(EBUS_NS::test_group_cancel() == true);
+    REQUIRE(EBUS_NS::test_chain_cancel() == true);
+    REQUIRE(EBUS_NS::test_polling() == true);
+}
@@ -177,6 +177,25 @@ test_grouped()
     return result;
 }
 
+struct sample_singleton
+{
+    int value = 0;
+};
+
+// the bus works the same on a context created up front, and the cached
+// pointer is the singleton itself.
+bool
+test_init()
+{
+    sample_group_bus::init();
+    sample_group_ebus_handler handler(2);
+
+    bool result = false;
+    sample_group_bus::invoke(result, 2, &sample_group_interface::request0, 0);
+    return result && &EBUS_NS::singleton_ref<sample_singleton>::get() ==
+                         &EBUS_NS::singleton<sample_singleton>::get_instance();
+}
+
 //////////////////////////////////////////////////////////////////////////////////////
 // main
 //////////////////////////////////////////////////////////////////////////////////////
@@ -186,4 +205,5 @@ TEST_CASE("test ebus interface [EBUS]")
     REQUIRE(test_id() == true);
     REQUIRE(test_typed() == true);
     REQUIRE(test_grouped() == true);
+    REQUIRE(test_init() == true);
 }
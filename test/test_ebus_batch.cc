@@ -0,0 +1,186 @@
+#include <ebus/ebus.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+struct physics_iface : public ebus_iface<ebus_type::GLOBAL>
+{
+    virtual void impulse(uint32_t body, float force) = 0;
+    virtual void wake(uint32_t body)                 = 0;
+};
+
+using physics_bus = ebus<physics_iface>;
+
+// only the scalar methods, unchanged.
+struct scalar_handler : public ebus_handler<physics_iface>
+{
+    scalar_handler() { connect(); }
+
+    void impulse(uint32_t body, float force) override
+    {
+        m_calls++;
+        m_force += force * body;
+    }
+    void wake(uint32_t) override { m_woken++; }
+
+    int   m_calls = 0;
+    int   m_woken = 0;
+    float m_force = 0;
+};
+
+struct batch_handler : public ebus_handler<physics_iface>,
+                       public ebus_batch_handler<&physics_iface::impulse>,
+                       public ebus_batch_handler<&physics_iface::wake>
+{
+    batch_handler() { connect(); }
+
+    void impulse(uint32_t, float) override { m_scalar++; }
+    void wake(uint32_t) override { m_scalar++; }
+
+    void on_batch(ebus_batch_of<&physics_iface::impulse>,
+                  ebus_batch_of<&physics_iface::impulse>::calls_t calls) override
+    {
+        m_batches++;
+        for (const auto& [body, force] : calls)
+        {
+            m_force += force * body;
+        }
+    }
+    void on_batch(ebus_batch_of<&physics_iface::wake>,
+                  ebus_batch_of<&physics_iface::wake>::calls_t calls) override
+    {
+        m_batches++;
+        m_woken += (int)calls.size();
+    }
+
+    int   m_scalar  = 0;
+    int   m_batches = 0;
+    int   m_woken   = 0;
+    float m_force   = 0;
+};
+
+// one call per batch handler, scalar handlers see every call, in order.
+bool
+test_batch_global()
+{
+    scalar_handler scalar;
+    batch_handler  batch;
+
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        physics_bus::queue_batch<&physics_iface::impulse>(i, 2.0f);
+    }
+    physics_bus::queue_batch<&physics_iface::wake>(1u);
+    if (scalar.m_calls != 0 || batch.m_batches != 0)
+        return false;
+
+    size_t impulses = physics_bus::flush_batch<&physics_iface::impulse>();
+    size_t wakes    = physics_bus::flush_batch<&physics_iface::wake>();
+    float  expected = 2.0f * 99 * 100 / 2;
+    return impulses == 100 && wakes == 1 && scalar.m_calls == 100 &&
+           scalar.m_force == expected && scalar.m_woken == 1 && batch.m_batches == 2 &&
+           batch.m_force == expected && batch.m_woken == 1 && batch.m_scalar == 0 &&
+           physics_bus::flush_batch<&physics_iface::impulse>() == 0;
+}
+
+struct lane_iface : public ebus_iface<ebus_type::GROUP>
+{
+    virtual void packet(uint32_t bytes) = 0;
+};
+
+using lane_bus = ebus<lane_iface>;
+
+struct lane_handler : public ebus_handler<lane_iface>,
+                      public ebus_batch_handler<&lane_iface::packet>
+{
+    explicit lane_handler(size_t lane) { connect(lane); }
+
+    void packet(uint32_t bytes) override { m_bytes += bytes; }
+    void on_batch(ebus_batch_of<&lane_iface::packet>,
+                  ebus_batch_of<&lane_iface::packet>::calls_t calls) override
+    {
+        m_batches++;
+        for (const auto& [bytes] : calls)
+        {
+            m_bytes += bytes;
+        }
+        // queued for the next flush.
+        if (m_requeue)
+            lane_bus::queue_batch<&lane_iface::packet>(m_requeue, 1u);
+        m_requeue = 0;
+    }
+
+    int      m_batches = 0;
+    uint32_t m_bytes   = 0;
+    size_t   m_requeue = 0;
+};
+
+// each group gets its own calls, handlers may queue while flushed.
+bool
+test_batch_group()
+{
+    lane_handler lane1(1), lane2(2);
+    lane1.m_requeue = 2;
+    for (int i = 0; i < 10; i++)
+    {
+        lane_bus::queue_batch<&lane_iface::packet>(1, 100u);
+        lane_bus::queue_batch<&lane_iface::packet>(2, 10u);
+        lane_bus::queue_batch<&lane_iface::packet>(3, 1u); // no handler
+    }
+    if (lane_bus::flush_batch<&lane_iface::packet>() != 30 || lane1.m_bytes != 1000 ||
+        lane2.m_bytes != 100 || lane1.m_batches != 1 || lane2.m_batches != 1)
+        return false;
+
+    return lane_bus::flush_batch<&lane_iface::packet>() == 1 && lane2.m_bytes == 101 &&
+           lane2.m_batches == 2 && lane1.m_batches == 1;
+}
+
+// a new id every tick, the ids of the previous ticks are dropped on flush.
+bool
+test_batch_transient()
+{
+    lane_handler lane5(5), lane6(6);
+    for (size_t tick = 0; tick < 100; tick++)
+    {
+        lane_bus::queue_batch<&lane_iface::packet>(5 + tick % 2, 1u);
+        lane_bus::queue_batch<&lane_iface::packet>(1000 + tick, 1u); // no handler
+        if (lane_bus::flush_batch<&lane_iface::packet>() != 2)
+            return false;
+    }
+    return lane5.m_bytes == 50 && lane6.m_bytes == 50 && lane5.m_batches == 50 &&
+           lane6.m_batches == 50 && lane_bus::flush_batch<&lane_iface::packet>() == 0;
+}
+
+// the calls are queued per thread.
+bool
+test_batch_threads()
+{
+    batch_handler batch;
+    physics_bus::queue_batch<&physics_iface::impulse>(1u, 1.0f);
+
+    size_t other = 0;
+    std::thread([&other]()
+                {
+                    physics_bus::queue_batch<&physics_iface::impulse>(1u, 4.0f);
+                    physics_bus::queue_batch<&physics_iface::impulse>(1u, 4.0f);
+                    other = physics_bus::flush_batch<&physics_iface::impulse>();
+                })
+        .join();
+    return other == 2 && batch.m_force == 8.0f &&
+           physics_bus::flush_batch<&physics_iface::impulse>() == 1 &&
+           batch.m_force == 9.0f && batch.m_batches == 2;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test batch handlers [EBUS]")
+{
+    REQUIRE(EBUS_NS::test_batch_global() == true);
+    REQUIRE(EBUS_NS::test_batch_group() == true);
+    REQUIRE(EBUS_NS::test_batch_transient() == true);
+    REQUIRE(EBUS_NS::test_batch_threads() == true);
+}
@@ -0,0 +1,108 @@
+#include <ebus/ebus.hh>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace EBUS_NS
+{
+
+struct input_iface : public ebus_iface<ebus_type::GLOBAL>
+{
+    virtual bool        key(int code)        = 0;
+    virtual ebus_result click(int x, int y) = 0;
+};
+
+using input_bus = ebus<input_iface>;
+
+struct input_layer : public ebus_handler<input_iface>
+{
+    input_layer(float priority, int consumed_key, int width) :
+        m_consumed_key(consumed_key),
+        m_width(width)
+    {
+        connect(ebus_priority_t(priority));
+    }
+
+    bool key(int code) override
+    {
+        m_keys++;
+        return code == m_consumed_key;
+    }
+    ebus_result click(int x, int) override
+    {
+        m_clicks++;
+        return x < m_width ? ebus_result::consumed : ebus_result::pass;
+    }
+
+    using ebus_handler<input_iface>::disconnect;
+
+    const int m_consumed_key;
+    const int m_width;
+    int       m_keys   = 0;
+    int       m_clicks = 0;
+};
+
+// the first handler in priority order which consumes it stops the dispatch.
+bool
+test_broadcast_until()
+{
+    input_layer hud(0, 'h', 100), modal(10, 27, 0), world(-1, -1, 1000);
+
+    bool escape  = input_bus::broadcast_until(&input_iface::key, 27) == &modal &&
+                   modal.m_keys == 1 && hud.m_keys == 0 && world.m_keys == 0;
+    bool hud_key = input_bus::broadcast_until(&input_iface::key, 'h') == &hud &&
+                   modal.m_keys == 2 && hud.m_keys == 1 && world.m_keys == 0;
+    bool none    = input_bus::broadcast_until(&input_iface::key, 'x') == nullptr &&
+                   modal.m_keys == 3 && hud.m_keys == 2 && world.m_keys == 1;
+
+    bool click = input_bus::broadcast_until(&input_iface::click, 500, 0) == &world &&
+                 modal.m_clicks == 1 && hud.m_clicks == 1 && world.m_clicks == 1;
+    hud.disconnect();
+    bool after = input_bus::broadcast_until(&input_iface::click, 50, 0) == &world &&
+                 hud.m_clicks == 1;
+    return escape && hud_key && none && click && after;
+}
+
+struct route_iface : public ebus_iface<ebus_type::GROUP>
+{
+    virtual bool packet(uint32_t port) = 0;
+};
+
+using route_bus = ebus<route_iface>;
+
+struct route : public ebus_handler<route_iface>
+{
+    route(size_t lane, float priority, uint32_t port) :
+        m_port(port)
+    {
+        connect(lane, ebus_priority_t(priority));
+    }
+
+    bool packet(uint32_t port) override
+    {
+        m_seen++;
+        return port == m_port;
+    }
+
+    const uint32_t m_port;
+    int            m_seen = 0;
+};
+
+bool
+test_multicast_until()
+{
+    route specific(1, 1, 80), fallback(1, 0, 0), other(2, 5, 80);
+
+    auto* matched = route_bus::multicast_until(1, &route_iface::packet, 80u);
+    auto* missed  = route_bus::multicast_until(1, &route_iface::packet, 22u);
+    auto* empty   = route_bus::multicast_until(3, &route_iface::packet, 80u);
+    return matched == &specific && missed == nullptr && empty == nullptr &&
+           specific.m_seen == 2 && fallback.m_seen == 1 && other.m_seen == 0;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test early exit dispatch [EBUS]")
+{
+    REQUIRE(EBUS_NS::test_broadcast_until() == true);
+    REQUIRE(EBUS_NS::test_multicast_until() == true);
+}
@@ -0,0 +1,120 @@
+#include <ebus/hooks.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+std::atomic<int> g_runs = 0;
+
+struct plugin_hooks : public hook_registry<plugin_hooks>
+{
+};
+
+EBUS_HOOK_REGISTRY_NAMED(plugin_hooks, core)
+{
+    g_runs++;
+}
+
+// a library loaded later adds its hooks, only those run.
+bool
+test_incremental()
+{
+    g_runs = 0;
+    plugin_hooks& hooks = plugin_hooks::instance();
+    if (hooks.pending() != 1 || hooks.run_hooks().hooks.size() != 1 || g_runs != 1)
+        return false;
+
+    hooks.add_hook([]() { g_runs += 10; }, "plugin", {"core"});
+    hooks.add_hook([]() { g_runs += 100; });
+    if (hooks.pending() != 2)
+        return false;
+    hook_report report = hooks.run_hooks();
+    return g_runs == 111 && report.hooks.size() == 2 && hooks.pending() == 0 &&
+           hooks.ran() == 3 && hooks.has_run("core") && hooks.has_run("plugin") &&
+           !hooks.has_run("other") && hooks.run_hooks().hooks.empty();
+}
+
+struct ui_hooks : public hook_registry<ui_hooks>
+{
+};
+
+// a hook waits for a dependency added later, with what depends on it.
+bool
+test_waiting()
+{
+    g_runs = 0;
+    ui_hooks& hooks = ui_hooks::instance();
+    hooks.add_hook([]() { g_runs += 10; }, "ui", {"gfx"});
+    hooks.add_hook([]() { g_runs += 100; }, "theme", {"ui"});
+    hooks.add_hook([]() { g_runs += 1000; });
+    hook_report report = hooks.run_hooks();
+    if (!report.waiting || report.cycle || !report.hooks[0].waiting ||
+        !report.hooks[1].waiting || report.hooks[2].waiting || g_runs != 1000 ||
+        hooks.pending() != 2 || hooks.has_run("ui"))
+        return false;
+
+    // still waiting without it.
+    if (!hooks.run_hooks().waiting || g_runs != 1000 || hooks.pending() != 2)
+        return false;
+
+    hooks.add_hook([]() { g_runs = g_runs == 1000 ? 1001 : -1; }, "gfx", {});
+    report = hooks.run_hooks();
+    return !report.waiting && report.hooks.size() == 3 && g_runs == 1111 &&
+           hooks.pending() == 0 && hooks.has_run("ui") && hooks.has_run("theme");
+}
+
+struct codec_registry : public lazy_hook_registry<codec_registry>
+{
+    std::atomic<int> codecs = 0;
+};
+
+EBUS_HOOK_REGISTRY_FUNCTION(codec_registry, flac)
+{
+    // the registry is usable from its own hooks.
+    codec_registry::instance().codecs++;
+}
+
+EBUS_HOOK_REGISTRY_FUNCTION(codec_registry, opus)
+{
+    codec_registry::instance().codecs++;
+}
+
+bool
+test_lazy()
+{
+    // nothing ran at startup.
+    codec_registry& registry = codec_registry::registry();
+    if (registry.pending() != 2 || registry.codecs != 0)
+        return false;
+
+    // every thread sees the hooks done.
+    std::vector<std::thread> threads;
+    std::atomic<int>         seen = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&seen]() { seen += codec_registry::instance().codecs; });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (seen != 8)
+        return false;
+
+    // a later hook runs on the next access.
+    registry.add_hook([]() { codec_registry::instance().codecs++; });
+    return codec_registry::instance().codecs == 3 && registry.ran() == 3;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test incremental and lazy hooks [HOOKS]")
+{
+    REQUIRE(EBUS_NS::test_incremental() == true);
+    REQUIRE(EBUS_NS::test_waiting() == true);
+    REQUIRE(EBUS_NS::test_lazy() == true);
+}
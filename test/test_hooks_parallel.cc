@@ -0,0 +1,175 @@
+#include <ebus/hooks.hh>
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+std::mutex               g_order_lock;
+std::vector<std::string> g_order;
+
+void
+ran(const char* name)
+{
+    std::scoped_lock<std::mutex> lock(g_order_lock);
+    g_order.push_back(name);
+}
+
+size_t
+position(const char* name)
+{
+    for (size_t i = 0; i < g_order.size(); i++)
+    {
+        if (g_order[i] == name)
+            return i;
+    }
+    return g_order.size();
+}
+
+struct ordered_hooks : public hook_registry<ordered_hooks>
+{
+};
+
+// registered in reverse, the dependencies decide the order.
+EBUS_HOOK_REGISTRY_NAMED(ordered_hooks, render, "window", "config")
+{
+    ran("render");
+}
+EBUS_HOOK_REGISTRY_NAMED(ordered_hooks, window, "config")
+{
+    ran("window");
+}
+EBUS_HOOK_REGISTRY_NAMED(ordered_hooks, config)
+{
+    ran("config");
+}
+EBUS_HOOK_REGISTRY_FUNCTION(ordered_hooks, unnamed)
+{
+    ran("unnamed");
+}
+
+bool
+test_dependency_order()
+{
+    g_order.clear();
+    default_task_scheduler scheduler(task_scheduler_config{.worker_count = 4});
+    hook_report            report = ordered_hooks::instance().run_hooks(true);
+
+    bool ordered = g_order.size() == 4 && position("config") < position("window") &&
+                   position("window") < position("render");
+    return ordered && report.parallel && report.hooks.size() == 4 &&
+           report.hooks[0].name == "render" && report.hooks[3].name.empty() &&
+           ordered_hooks::instance().run_hooks().hooks.empty();
+}
+
+struct slow_hooks : public hook_registry<slow_hooks>
+{
+};
+
+bool
+test_parallel_hooks()
+{
+    const int nhooks = 4;
+    for (int i = 0; i < nhooks; i++)
+    {
+        slow_hooks::instance().add_hook(
+            []() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    }
+    default_task_scheduler scheduler(task_scheduler_config{.worker_count = nhooks});
+    hook_report            report = slow_hooks::instance().run_hooks(true);
+
+    // sleeping hooks overlap even on a single core.
+    bool timed = true;
+    for (const auto& hook : report.hooks)
+    {
+        timed = timed && hook.took >= std::chrono::milliseconds(50);
+    }
+    return timed && report.parallel && report.took < std::chrono::milliseconds(150);
+}
+
+struct serial_hooks : public hook_registry<serial_hooks>
+{
+};
+
+// without a scheduler the hooks run in registration order on this thread,
+// unless a dependency says otherwise.
+bool
+test_serial_fallback()
+{
+    g_order.clear();
+    serial_hooks::instance().add_hook([]() { ran("first"); }, "first", {"last"});
+    serial_hooks::instance().add_hook([]() { ran("second"); });
+    serial_hooks::instance().add_hook([]() { ran("third"); });
+    serial_hooks::instance().add_hook([]() { ran("last"); }, "last", {});
+    hook_report report = serial_hooks::instance().run_hooks();
+
+    std::vector<std::string> expected = {"second", "third", "last", "first"};
+    return !report.parallel && g_order == expected;
+}
+
+struct legacy_hooks : public hook_registry<legacy_hooks>
+{
+};
+
+std::thread::id g_first, g_second;
+
+// hooks written when they all ran on the caller keep doing so.
+bool
+test_serial_by_default()
+{
+    legacy_hooks::instance().add_hook([]() { g_first = std::this_thread::get_id(); });
+    legacy_hooks::instance().add_hook([]() { g_second = std::this_thread::get_id(); });
+    default_task_scheduler scheduler(task_scheduler_config{.worker_count = 2});
+    hook_report            report = legacy_hooks::instance().run_hooks();
+
+    std::thread::id caller = std::this_thread::get_id();
+    return !report.parallel && g_first == caller && g_second == caller;
+}
+
+struct cyclic_hooks : public hook_registry<cyclic_hooks>
+{
+};
+
+// a cycle is skipped with what depends on it and kept, the rest still runs.
+bool
+test_cycle()
+{
+    g_order.clear();
+    cyclic_hooks& hooks = cyclic_hooks::instance();
+    hooks.add_hook([]() { ran("a"); }, "a", {"b"});
+    hooks.add_hook([]() { ran("b"); }, "b", {"a"});
+    hooks.add_hook([]() { ran("c"); }, "c", {"a"});
+    hooks.add_hook([]() { ran("d"); }, "d", {});
+    default_task_scheduler scheduler(task_scheduler_config{.worker_count = 2});
+    hook_report            report = hooks.run_hooks(true);
+
+    std::vector<std::string> expected = {"d"};
+    bool skipped = report.hooks[0].skipped && report.hooks[1].skipped &&
+                   report.hooks[2].skipped && !report.hooks[3].skipped;
+    if (!report.cycle || report.waiting || report.parallel || !skipped ||
+        g_order != expected || hooks.ran() != 1 || !hooks.has_run("d") ||
+        hooks.has_run("a") || hooks.pending() != 3)
+        return false;
+
+    // still a cycle on the next run.
+    report = hooks.run_hooks(true);
+    return report.cycle && report.hooks.size() == 3 && g_order == expected &&
+           hooks.pending() == 3;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test hooks dependencies [HOOKS]")
+{
+    REQUIRE(EBUS_NS::test_dependency_order() == true);
+    REQUIRE(EBUS_NS::test_parallel_hooks() == true);
+    REQUIRE(EBUS_NS::test_serial_fallback() == true);
+    REQUIRE(EBUS_NS::test_serial_by_default() == true);
+    REQUIRE(EBUS_NS::test_cycle() == true);
+}
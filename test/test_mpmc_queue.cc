@@ -0,0 +1,194 @@
+#include "ebus/task_worker.hh"
+#include "ebus/memory/mpmc_queue.hh"
+#include "ebus/memory/blocking_queue.hh"
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////////////////
+// mpmc_queue
+//////////////////////////////////////////////////////////////////////////////////////
+
+bool
+test_bounded()
+{
+    EBUS_NS::mpmc_queue<int> queue(3); // rounded to 4
+    int                      item = 0;
+
+    if (queue.capacity() != 4 || queue.try_pop(item))
+        return false;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!queue.try_push(i))
+            return false;
+    }
+    if (queue.try_push(4) || queue.size() != 4)
+        return false;
+    // FIFO order
+    for (int i = 0; i < 4; i++)
+    {
+        if (!queue.try_pop(item) || item != i)
+            return false;
+    }
+    return queue.size() == 0;
+}
+
+bool
+test_mpmc()
+{
+    const int                nproducers = 4;
+    const int                nconsumers = 4;
+    const int                count      = 10000;
+    EBUS_NS::mpmc_queue<int> queue(64);
+    std::atomic<long>        sum      = 0;
+    std::atomic<int>         consumed = 0;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < nproducers; p++)
+    {
+        threads.emplace_back(
+            [&queue, count]()
+            {
+                for (int i = 1; i <= count; i++)
+                    queue.push(i);
+            });
+    }
+    for (int c = 0; c < nconsumers; c++)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                int item = 0;
+                while (consumed.load() < nproducers * count)
+                {
+                    if (queue.try_pop(item))
+                    {
+                        sum += item;
+                        consumed++;
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    return sum == (long)nproducers * count * (count + 1) / 2;
+}
+
+// a full queue spills instead of waiting, in order.
+bool
+test_spill()
+{
+    EBUS_NS::blocking_queue<EBUS_NS::mpmc_queue<int>> queue(4);
+    std::vector<int>                                  items = {4, 5, 6};
+    for (int i = 0; i < 4; i++)
+    {
+        queue.push(i);
+    }
+    queue.push_n(items.begin(), items.end());
+    if (queue.size() != 7 || queue.spills() != 3)
+        return false;
+
+    int popped[7] = {};
+    if (queue.pop_n(popped, 2) != 2)
+        return false;
+    popped[2] = queue.pop();
+    if (queue.pop_n(popped + 3, 4) != 4)
+        return false;
+    for (int i = 0; i < 7; i++)
+    {
+        if (popped[i] != i)
+            return false;
+    }
+    return queue.size() == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// lockfree_task_worker
+//////////////////////////////////////////////////////////////////////////////////////
+
+class counting_task : public EBUS_NS::task_base
+{
+public:
+    counting_task(std::atomic<int>& counter) :
+        task_base(
+            [&counter]()
+            {
+                counter++;
+                return true;
+            })
+    {
+    }
+
+    virtual void task_done() override {}
+    virtual void add_ref() override { ++m_refcount; }
+    virtual void release() override
+    {
+        if (--m_refcount <= 0)
+            delete this;
+    }
+
+private:
+    std::atomic<int> m_refcount = 0;
+};
+
+bool
+test_lockfree_worker()
+{
+    std::atomic<int>              counter = 0;
+    EBUS_NS::lockfree_task_worker worker(16);
+
+    std::thread worker_thread([&worker]() { worker(); });
+    for (int i = 0; i < 100; i++)
+    {
+        worker.add_task(EBUS_NS::task_base::ptr(new counting_task(counter)));
+    }
+    worker.shutdown();
+    worker_thread.join();
+
+    return counter == 100;
+}
+
+// a task of the worker overfilling its own queue.
+bool
+test_lockfree_self_submit()
+{
+    std::atomic<int>              counter = 0;
+    EBUS_NS::lockfree_task_worker worker(16);
+
+    std::thread worker_thread([&worker]() { worker(); });
+    worker.add_task(EBUS_NS::make_task(
+        [&worker, &counter]()
+        {
+            for (int i = 0; i < 100; i++)
+            {
+                worker.add_task(EBUS_NS::task_base::ptr(new counting_task(counter)));
+            }
+        }));
+    while (counter < 100)
+    {
+        std::this_thread::yield();
+    }
+    worker.shutdown();
+    worker_thread.join();
+    return counter == 100;
+}
+
+TEST_CASE("test mpmc queue [MEMORY]")
+{
+    REQUIRE(test_bounded() == true);
+    REQUIRE(test_mpmc() == true);
+    REQUIRE(test_spill() == true);
+}
+
+TEST_CASE("test lockfree task worker [TASK_WORKER]")
+{
+    REQUIRE(test_lockfree_worker() == true);
+    REQUIRE(test_lockfree_self_submit() == true);
+}
@@ -0,0 +1,90 @@
+#include <ebus/parallel.hh>
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+bool
+test_for()
+{
+    std::vector<int> data(10000, 0);
+
+    parallel_for(0, data.size(), [&data](size_t i) { data[i] += (int)i; });
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        if (data[i] != (int)i)
+            return false;
+    }
+    // nested, the inner loops run on the workers and must not dead lock.
+    std::atomic<int> counter = 0;
+    parallel_for(0,
+                 8,
+                 [&counter](size_t)
+                 { parallel_for(0, 100, [&counter](size_t) { counter++; }); });
+    return counter == 800;
+}
+
+bool
+test_reduce()
+{
+    size_t sum = parallel_reduce(
+        1, 100001, size_t(0), [](size_t i) { return i; }, std::plus<>{});
+    size_t max = parallel_reduce(
+        0,
+        1000,
+        size_t(0),
+        [](size_t i) { return (i * 7919) % 1000; },
+        [](size_t a, size_t b) { return std::max(a, b); },
+        16);
+    return sum == 5000050000ull && max == 999;
+}
+
+bool
+test_scan()
+{
+    std::vector<int> in(5000), out(5000), expect(5000);
+    std::iota(in.begin(), in.end(), 0);
+    std::inclusive_scan(in.begin(), in.end(), expect.begin(), std::plus<>{}, 3);
+
+    auto end = parallel_scan(in.begin(), in.end(), out.begin(), 3);
+    return end == out.end() && out == expect;
+}
+
+bool
+test_sort()
+{
+    std::mt19937     rng(42);
+    std::vector<int> data(20000);
+    for (int& v : data)
+        v = (int)(rng() % 100000);
+    std::vector<int> expect = data;
+    std::sort(expect.begin(), expect.end());
+
+    parallel_sort(data.begin(), data.end(), std::less<>{}, 256);
+    return data == expect;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test parallel algorithms without scheduler [PARALLEL]")
+{
+    REQUIRE(EBUS_NS::test_for() == true);
+    REQUIRE(EBUS_NS::test_sort() == true);
+}
+
+TEST_CASE("test parallel algorithms [PARALLEL]")
+{
+    EBUS_NS::default_task_scheduler scheduler;
+
+    REQUIRE(EBUS_NS::test_for() == true);
+    REQUIRE(EBUS_NS::test_reduce() == true);
+    REQUIRE(EBUS_NS::test_scan() == true);
+    REQUIRE(EBUS_NS::test_sort() == true);
+}
@@ -0,0 +1,170 @@
+#include <ebus/memory/ref_counted.hh>
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+std::atomic<int> g_destroyed = 0;
+
+template <class count_t>
+struct counted : ref_counted<counted<count_t>, count_t>
+{
+    ~counted() { g_destroyed++; }
+};
+
+template <class count_t>
+using counted_ptr = INTRUSIVE_NS::intrusive_ptr<counted<count_t>>;
+
+bool
+test_single_thread()
+{
+    g_destroyed = 0;
+    {
+        counted_ptr<single_thread_count> a(new counted<single_thread_count>);
+        counted_ptr<single_thread_count> b = a;
+        a.reset();
+        if (g_destroyed != 0)
+            return false;
+    }
+    return g_destroyed == 1;
+}
+
+bool
+test_atomic()
+{
+    g_destroyed = 0;
+    {
+        counted_ptr<atomic_count> shared(new counted<atomic_count>);
+        std::vector<std::thread>  threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back(
+                [shared]()
+                {
+                    for (int i = 0; i < 10000; i++)
+                    {
+                        counted_ptr<atomic_count> copy = shared;
+                    }
+                });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        if (g_destroyed != 0)
+            return false;
+    }
+    return g_destroyed == 1;
+}
+
+// the owner copies and drops on its own, another thread drops the last
+// references, which come back to the owner's queue.
+bool
+test_biased()
+{
+    const int nobjects = 1000;
+    g_destroyed        = 0;
+
+    std::vector<counted_ptr<biased_count>> handed;
+    for (int i = 0; i < nobjects; i++)
+    {
+        counted_ptr<biased_count> p(new counted<biased_count>);
+        counted_ptr<biased_count> copy = p;
+        handed.push_back(std::move(p));
+    }
+    if (g_destroyed != 0)
+        return false;
+
+    std::thread([&handed]() { handed.clear(); }).join();
+    if (g_destroyed != 0)
+        return false;
+
+    // the owner merges its queue on its next counting.
+    counted_ptr<biased_count> next(new counted<biased_count>);
+    return g_destroyed == nobjects;
+}
+
+// objects outliving their owner thread are merged by whoever drops them.
+bool
+test_biased_owner_exit()
+{
+    const int nobjects = 100;
+    g_destroyed        = 0;
+
+    std::vector<counted_ptr<biased_count>> kept;
+    std::thread(
+        [&kept]()
+        {
+            for (int i = 0; i < nobjects; i++)
+            {
+                kept.emplace_back(new counted<biased_count>);
+            }
+        })
+        .join();
+    if (g_destroyed != 0)
+        return false;
+    kept.clear();
+    return g_destroyed == nobjects;
+}
+
+class tracked_task final : public task_base, public ref_counted<tracked_task>
+{
+public:
+    tracked_task(std::atomic<int>& refs, std::atomic_bool& ran) :
+        task_base(
+            [&ran]()
+            {
+                ran = true;
+                return true;
+            }),
+        m_refs(refs)
+    {
+    }
+
+    virtual void task_done() override {}
+    virtual void add_ref() override
+    {
+        m_refs++;
+        ref_counted::add_ref();
+    }
+    virtual void release() override { ref_counted::release(); }
+
+private:
+    std::atomic<int>& m_refs;
+};
+
+// moved all the way to the worker, the task is only counted once.
+bool
+test_moved_submission()
+{
+    std::atomic<int> refs = 0;
+    std::atomic_bool ran  = false;
+    {
+        default_task_scheduler scheduler;
+        task_base::ptr         task(new tracked_task(refs, ran));
+        task_scheduler_iface::add_task(std::move(task));
+        while (!ran)
+            std::this_thread::yield();
+    }
+    return refs == 1;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test ref counted policies [MEMORY]")
+{
+    REQUIRE(EBUS_NS::test_single_thread() == true);
+    REQUIRE(EBUS_NS::test_atomic() == true);
+    REQUIRE(EBUS_NS::test_biased() == true);
+    REQUIRE(EBUS_NS::test_biased_owner_exit() == true);
+}
+
+TEST_CASE("test moved task submission [TASK]")
+{
+    REQUIRE(EBUS_NS::test_moved_submission() == true);
+}
@@ -0,0 +1,295 @@
+#include <ebus/ipc/shm_ring.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#    include <fcntl.h>
+#    include <signal.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+#endif
+
+namespace EBUS_NS
+{
+
+struct point
+{
+    float x, y;
+};
+
+struct input_iface : public ebus_iface<ebus_type::GLOBAL>
+{
+    virtual void key_down(int key)                      = 0;
+    virtual void move(const point& to, uint8_t buttons) = 0;
+    virtual void unmarshalled(int)                      = 0;
+};
+
+using input_marshal =
+    bus_marshal<input_iface, &input_iface::key_down, &input_iface::move>;
+
+struct input_handler : public ebus_handler<input_iface>
+{
+    input_handler() { connect(); }
+
+    void key_down(int key) override
+    {
+        m_keys++;
+        m_key_sum += key;
+    }
+    void move(const point& to, uint8_t buttons) override
+    {
+        m_to      = to;
+        m_buttons = buttons;
+    }
+    void unmarshalled(int) override {}
+
+    std::atomic<int>     m_keys    = 0;
+    std::atomic<int64_t> m_key_sum = 0;
+    point                m_to      = {};
+    uint8_t              m_buttons = 0;
+};
+
+struct route_iface : public ebus_iface<ebus_type::GROUP>
+{
+    virtual void packet(uint32_t size) = 0;
+};
+
+using route_marshal = bus_marshal<route_iface, &route_iface::packet>;
+
+struct route_handler : public ebus_handler<route_iface>
+{
+    explicit route_handler(size_t group) { connect(group); }
+
+    void packet(uint32_t size) override { m_bytes += size; }
+
+    uint32_t m_bytes = 0;
+};
+
+std::string
+segment_name(const char* test)
+{
+#if defined(__linux__)
+    return std::string("/ebus-") + test + "-" + std::to_string(getpid());
+#else
+    return test;
+#endif
+}
+
+// the arguments are converted to the parameters and copied byte for byte.
+bool
+test_marshal()
+{
+    input_handler handler;
+    route_handler route0(0), route1(1);
+
+    bus_record key  = input_marshal::encode(0, &input_iface::key_down, 'a');
+    bus_record move = input_marshal::encode(0, &input_iface::move, point{1.5f, 2.0f}, 3);
+    bus_record pkt  = route_marshal::encode(1, &route_iface::packet, 1500);
+
+    bus_dispatch_table table;
+    table.add<input_marshal>();
+    table.add<route_marshal>();
+
+    bus_record unknown = key;
+    unknown.iface++;
+    // malformed records, from another build or a corrupt file, are refused.
+    bus_record bad_method = key;
+    bad_method.method     = 7;
+    bus_record bad_length = move;
+    bad_length.length     = key.length;
+    bool dispatched = table.dispatch(key) && table.dispatch(move) &&
+                      table.dispatch(pkt) && !table.dispatch(unknown) &&
+                      !table.dispatch(bad_method) && !table.dispatch(bad_length);
+
+    return dispatched && move.method == 1 && handler.m_key_sum == 'a' &&
+           handler.m_to.x == 1.5f && handler.m_to.y == 2.0f && handler.m_buttons == 3 &&
+           route0.m_bytes == 0 && route1.m_bytes == 1500;
+}
+
+#if defined(__linux__)
+
+// a producer thread on its own mapping of the segment, batching.
+bool
+test_ring_threads()
+{
+    const int nkeys = 20000;
+    shm_ring  ring  = shm_ring::create(segment_name("threads"), 256);
+    if (!ring.valid() || ring.capacity() != 256)
+        return false;
+
+    input_handler handler;
+    shm_receiver  receiver(ring);
+    receiver.add<input_marshal>();
+
+    std::thread producer(
+        []()
+        {
+            shm_ring   ring = shm_ring::open(segment_name("threads"));
+            shm_sender sender(ring, 32);
+            for (int i = 0; i < nkeys; i++)
+            {
+                sender.broadcast<input_marshal>(&input_iface::key_down, i);
+            }
+        });
+    while (handler.m_keys < nkeys)
+    {
+        receiver.wait_and_poll(std::chrono::milliseconds(100));
+    }
+    producer.join();
+    return handler.m_key_sum == (int64_t)nkeys * (nkeys - 1) / 2 && ring.size() == 0 &&
+           receiver.unknown() == 0;
+}
+
+// another process sends, this one dispatches.
+bool
+test_ring_process()
+{
+    const int nkeys = 1000;
+    shm_ring  ring  = shm_ring::create(segment_name("process"), 64);
+    if (!ring.valid())
+        return false;
+
+    input_handler handler;
+    shm_receiver  receiver(ring);
+    receiver.add<input_marshal>();
+
+    std::string name  = segment_name("process");
+    pid_t       child = fork();
+    if (child == 0)
+    {
+        shm_ring   ring = shm_ring::open(name);
+        shm_sender sender(ring, 8);
+        for (int i = 0; i < nkeys; i++)
+        {
+            sender.broadcast<input_marshal>(&input_iface::key_down, 1);
+        }
+        sender.broadcast<input_marshal>(&input_iface::move, point{4, 2}, 1);
+        sender.flush();
+        _exit(ring.valid() ? 0 : 1);
+    }
+
+    // a child which died early sends nothing more.
+    auto deadline = task_clock::now() + std::chrono::seconds(30);
+    while ((handler.m_keys < nkeys || handler.m_buttons == 0) &&
+           task_clock::now() < deadline)
+    {
+        receiver.wait_and_poll(std::chrono::milliseconds(100));
+    }
+    int status = 0;
+    if (handler.m_keys < nkeys || handler.m_buttons == 0)
+    {
+        kill(child, SIGKILL);
+        waitpid(child, &status, 0);
+        return false;
+    }
+    waitpid(child, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 && handler.m_key_sum == nkeys &&
+           handler.m_to.x == 4 && handler.m_to.y == 2;
+}
+
+// without a consumer a full ring drops the records past the timeout, and the
+// destructor does not wait at all.
+bool
+test_ring_full()
+{
+    shm_ring ring = shm_ring::create(segment_name("full"), 4);
+    if (!ring.valid() || ring.capacity() != 4)
+        return false;
+
+    shm_sender sender(ring, 1, std::chrono::milliseconds(1));
+    for (int i = 0; i < 6; i++)
+    {
+        sender.broadcast<input_marshal>(&input_iface::key_down, i);
+    }
+    bool dropped = sender.dropped() == 2 && ring.size() == 4;
+
+    auto start = task_clock::now();
+    {
+        shm_sender pending(ring, 8, std::chrono::hours(1));
+        pending.broadcast<input_marshal>(&input_iface::key_down, 6);
+    }
+    return dropped && task_clock::now() - start < std::chrono::minutes(1);
+}
+
+bool
+test_open_missing()
+{
+    return !shm_ring::open(segment_name("missing")).valid();
+}
+
+// a segment with a capacity which is not a power of two is refused.
+bool
+test_open_corrupted()
+{
+    std::string name  = segment_name("corrupted");
+    shm_ring    ring  = shm_ring::create(name, 4);
+    shm_ring    ring8 = shm_ring::create(segment_name("corrupted8"), 8);
+    if (!ring.valid() || !ring8.valid() || !shm_ring::open(name).valid())
+        return false;
+
+    struct stat st, st8;
+    int         fd  = shm_open(name.c_str(), O_RDWR, 0600);
+    int         fd8 = shm_open(segment_name("corrupted8").c_str(), O_RDONLY, 0600);
+    fstat(fd, &st);
+    fstat(fd8, &st8);
+    close(fd8);
+
+    // the magic, then the capacity, in a segment sized for 3 cells.
+    off_t cell  = (st8.st_size - st.st_size) / 4;
+    void* bytes = mmap(nullptr, 16, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    static_cast<uint64_t*>(bytes)[1] = 3;
+    munmap(bytes, 16);
+    bool truncated = ftruncate(fd, st.st_size - cell) == 0;
+    close(fd);
+    return truncated && !shm_ring::open(name).valid();
+}
+
+// an invalid ring neither takes nor gives records.
+bool
+test_invalid_ring()
+{
+    shm_ring ring;
+    if (ring.valid() || ring.capacity() != 0 || ring.size() != 0)
+        return false;
+
+    input_handler handler;
+    shm_receiver  receiver(ring);
+    receiver.add<input_marshal>();
+    bool sent;
+    {
+        shm_sender sender(ring, 4);
+        sender.broadcast<input_marshal>(&input_iface::key_down, 1);
+        sent = sender.flush() || sender.dropped() != 1;
+        ring.notify();
+    }
+    auto start = task_clock::now();
+    return !sent && receiver.wait_and_poll(std::chrono::hours(1)) == 0 &&
+           receiver.poll() == 0 && handler.m_keys == 0 &&
+           task_clock::now() - start < std::chrono::minutes(1);
+}
+
+#endif
+
+} // namespace EBUS_NS
+
+TEST_CASE("test bus marshalling [IPC]")
+{
+    REQUIRE(EBUS_NS::test_marshal() == true);
+}
+
+#if defined(__linux__)
+TEST_CASE("test shared memory transport [IPC]")
+{
+    REQUIRE(EBUS_NS::test_open_missing() == true);
+    REQUIRE(EBUS_NS::test_open_corrupted() == true);
+    REQUIRE(EBUS_NS::test_invalid_ring() == true);
+    REQUIRE(EBUS_NS::test_ring_full() == true);
+    REQUIRE(EBUS_NS::test_ring_threads() == true);
+    REQUIRE(EBUS_NS::test_ring_process() == true);
+}
+#endif
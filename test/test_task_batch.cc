@@ -0,0 +1,142 @@
+#include <ebus/task_scheduler.hh>
+#include <ebus/memory/safe_queue.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+class counting_task final : public task_base
+{
+public:
+    counting_task(std::atomic<int>& counter) :
+        task_base(
+            [&counter]()
+            {
+                counter++;
+                return true;
+            })
+    {
+    }
+
+    virtual void task_done() override {}
+    virtual void add_ref() override { ++m_refcount; }
+    virtual void release() override
+    {
+        if (--m_refcount <= 0)
+            delete this;
+    }
+
+private:
+    std::atomic<int> m_refcount = 0;
+};
+
+bool
+test_bulk_queue()
+{
+    safe_queue<int>  queue;
+    std::vector<int> in = {0, 1, 2, 3, 4, 5, 6, 7};
+    int              out[5];
+
+    queue.push_n(in.begin(), in.end());
+    if (queue.size() != in.size())
+        return false;
+    // FIFO and bounded by max
+    if (queue.pop_n(out, 5) != 5 || out[0] != 0 || out[4] != 4)
+        return false;
+    return queue.pop_n(out, 5) == 3 && out[2] == 7 && queue.size() == 0;
+}
+
+struct probed_queue : public safe_queue<int>
+{
+    size_t waiters()
+    {
+        std::lock_guard<std::mutex> lock(m_access);
+        return m_waiters;
+    }
+};
+
+// two parked consumers, two items pushed back to back or in bulk, both
+// consumers are woken.
+bool
+test_two_waiters(bool bulk)
+{
+    probed_queue     queue;
+    std::atomic<int> popped = 0;
+    auto             consume = [&queue, &popped]()
+    {
+        queue.pop();
+        popped++;
+    };
+    std::thread first(consume), second(consume);
+    while (queue.waiters() < 2)
+    {
+        std::this_thread::yield();
+    }
+
+    std::vector<int> items = {1, 2};
+    if (bulk)
+        queue.push_n(items.begin(), items.end());
+    else
+    {
+        queue.push(1);
+        queue.push(2);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (popped < 2 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+    bool woken = popped == 2;
+    // releases a consumer left parked.
+    queue.push_n(items.begin(), items.end());
+    first.join();
+    second.join();
+    return woken && queue.wakeups() == 2;
+}
+
+bool
+test_add_tasks()
+{
+    const int        ntasks  = 1000;
+    std::atomic<int> counter = 0;
+    {
+        default_task_scheduler      scheduler;
+        std::vector<task_base::ptr> tasks;
+        for (int i = 0; i < ntasks; i++)
+        {
+            tasks.emplace_back(new counting_task(counter));
+        }
+        task_scheduler_iface::add_tasks(tasks);
+
+        // tasks are moved to the workers.
+        for (auto& task : tasks)
+        {
+            if (task)
+                return false;
+        }
+        while (counter < ntasks)
+        {
+            std::this_thread::yield();
+        }
+    }
+    return counter == ntasks;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test bulk queue operations [MEMORY]")
+{
+    REQUIRE(EBUS_NS::test_bulk_queue() == true);
+    REQUIRE(EBUS_NS::test_two_waiters(false) == true);
+    REQUIRE(EBUS_NS::test_two_waiters(true) == true);
+}
+
+TEST_CASE("test batched task submission [TASK]")
+{
+    REQUIRE(EBUS_NS::test_add_tasks() == true);
+}
@@ -0,0 +1,120 @@
+#include <ebus/task_chain.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace EBUS_NS
+{
+
+bool
+test_typed_steps()
+{
+    std::atomic_bool done = false;
+    std::string      result;
+    {
+        default_task_scheduler scheduler;
+        make_chain([]() { return 21; })
+            .then([](int value) { return value * 2; })
+            .then([](int value) { return std::to_string(value); })
+            .then(
+                [&](std::string text)
+                {
+                    result = std::move(text);
+                    done   = true;
+                })
+            .submit();
+        while (!done)
+            std::this_thread::yield();
+    }
+    return result == "42";
+}
+
+bool
+test_void_steps()
+{
+    std::atomic<int> order = 0;
+    int              first = -1, second = -1, third = -1;
+    {
+        default_task_scheduler scheduler;
+        make_chain([&]() { first = order++; })
+            .then([&]() { second = order++; })
+            .then(
+                [&]()
+                {
+                    third = order++;
+                    return third;
+                })
+            .then([&](int) { order++; })
+            .submit();
+        while (order < 4)
+            std::this_thread::yield();
+    }
+    return first == 0 && second == 1 && third == 2;
+}
+
+bool
+test_move_only()
+{
+    std::atomic_bool done  = false;
+    int              value = 0;
+    {
+        default_task_scheduler scheduler;
+        auto                   owned = std::make_unique<int>(1);
+        make_chain([owned = std::move(owned)]() mutable { return std::move(owned); })
+            .then(
+                [](std::unique_ptr<int> p)
+                {
+                    *p += 1;
+                    return p;
+                })
+            .then(
+                [&](std::unique_ptr<int> p)
+                {
+                    value = *p;
+                    done  = true;
+                })
+            .submit();
+        while (!done)
+            std::this_thread::yield();
+    }
+    return value == 2;
+}
+
+bool
+test_chain_cancel()
+{
+    std::atomic<int> steps = 0;
+    cancel_token     token = cancel_token::make();
+    {
+        default_task_scheduler scheduler;
+        auto chain = make_chain(
+                         [&steps, token]()
+                         {
+                             steps++;
+                             // superseded while running.
+                             token.cancel();
+                             return 1;
+                         })
+                         .then([&steps](int) { steps++; });
+
+        task_base::ptr task = std::move(chain).task();
+        task->m_cancel      = token;
+        task_scheduler_iface::add_task(task);
+        while (steps == 0)
+            std::this_thread::yield();
+    }
+    return steps == 1;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test task chains [TASK]")
+{
+    REQUIRE(EBUS_NS::test_typed_steps() == true);
+    REQUIRE(EBUS_NS::test_void_steps() == true);
+    REQUIRE(EBUS_NS::test_move_only() == true);
+    REQUIRE(EBUS_NS::test_chain_cancel() == true);
+}
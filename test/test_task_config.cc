@@ -0,0 +1,96 @@
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#    include <pthread.h>
+#    include <sched.h>
+#endif
+
+namespace EBUS_NS
+{
+
+bool
+test_worker_config()
+{
+    std::mutex            lock;
+    std::set<std::string> names;
+    std::set<int>         cpus;
+    std::atomic<int>      counter = 0;
+    {
+        task_scheduler_config config;
+        config.worker_count = 3;
+        config.cpu_sets     = {{0}};
+        config.thread_name  = "pinned";
+        default_task_scheduler scheduler(config);
+        if (task_scheduler_iface::concurrency() != 3)
+            return false;
+
+        for (int i = 0; i < 30; i++)
+        {
+            task_scheduler_iface::add_task(make_task(
+                [&]()
+                {
+#if defined(__linux__)
+                    char name[16] = {};
+                    pthread_getname_np(pthread_self(), name, sizeof(name));
+                    std::lock_guard<std::mutex> guard(lock);
+                    names.insert(name);
+                    cpus.insert(sched_getcpu());
+#endif
+                    counter++;
+                }));
+        }
+        // the names and cpus are collected by the tasks.
+        while (counter < 30)
+            std::this_thread::yield();
+    }
+#if defined(__linux__)
+    for (const std::string& name : names)
+    {
+        if (name.rfind("pinned-", 0) != 0)
+            return false;
+    }
+    if (cpus != std::set<int>{0})
+        return false;
+#endif
+    return counter == 30;
+}
+
+bool
+test_side_pools()
+{
+    std::atomic<int> bus_counter = 0, side_counter = 0;
+    {
+        task_scheduler_config numa;
+        numa.numa_aware = true;
+        default_task_scheduler main_pool(numa);
+
+        task_scheduler_config side;
+        side.worker_count = 1;
+        side.thread_name  = "side";
+        side.connect      = false;
+        default_task_scheduler side_pool(side);
+
+        for (int i = 0; i < 10; i++)
+        {
+            task_scheduler_iface::add_task(make_task([&]() { bus_counter++; }));
+            side_pool.m_add_task(make_task([&]() { side_counter++; }));
+        }
+    }
+    // the side pool does not get the broadcasts.
+    return bus_counter == 10 && side_counter == 10;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test task scheduler config [TASK]")
+{
+    REQUIRE(EBUS_NS::test_worker_config() == true);
+    REQUIRE(EBUS_NS::test_side_pools() == true);
+}
@@ -0,0 +1,98 @@
+#include <ebus/task_graph.hh>
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+// each node records when it ran, a node must run after all its predecessors.
+bool
+test_graph()
+{
+    default_task_scheduler scheduler;
+    task_graph             graph;
+    std::atomic<int>       clock = 0;
+    std::vector<int>       stamps(8, -1);
+
+    std::vector<task_graph::node_id> nodes;
+    for (int i = 0; i < 8; i++)
+    {
+        nodes.push_back(graph.add_node(
+            [i, &clock, &stamps]()
+            {
+                stamps[i] = clock++;
+                return true;
+            }));
+    }
+    // 0 fans out to 1, 2, 3; 4 fans in from 1, 2, 3; 5 and 6 after 4; 7 after
+    // everything, with an independent root 7 depends on.
+    graph.precede(nodes[0], nodes[1]);
+    graph.precede(nodes[0], nodes[2]);
+    graph.precede(nodes[0], nodes[3]);
+    graph.precede(nodes[1], nodes[4]);
+    graph.precede(nodes[2], nodes[4]);
+    graph.precede(nodes[3], nodes[4]);
+    graph.precede(nodes[4], nodes[5]);
+    graph.precede(nodes[4], nodes[6]);
+    graph.precede(nodes[5], nodes[7]);
+    graph.precede(nodes[6], nodes[7]);
+
+    auto before = [&stamps](int a, int b) { return stamps[a] < stamps[b]; };
+
+    // the same graph re-executed, like a frame pipeline.
+    for (int frame = 0; frame < 3; frame++)
+    {
+        graph.run_and_wait();
+        for (int stamp : stamps)
+        {
+            if (stamp < frame * 8)
+                return false;
+        }
+        if (!(before(0, 1) && before(0, 2) && before(0, 3) && before(1, 4) &&
+              before(2, 4) && before(3, 4) && before(4, 5) && before(4, 6) &&
+              before(5, 7) && before(6, 7)))
+            return false;
+    }
+    return clock == 24;
+}
+
+bool
+test_wide_graph()
+{
+    default_task_scheduler scheduler;
+    task_graph             graph;
+    std::atomic<int>       counter = 0;
+
+    // layers of 20 nodes, each depending on every node of the previous layer.
+    std::vector<task_graph::node_id> prev, layer;
+    for (int l = 0; l < 10; l++)
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            layer.push_back(graph.add_node(
+                [&counter]()
+                {
+                    counter++;
+                    return true;
+                }));
+            for (auto p : prev)
+                graph.precede(p, layer.back());
+        }
+        prev = std::move(layer);
+        layer.clear();
+    }
+    graph.run_and_wait();
+    graph.run_and_wait();
+    return counter == 400;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test task graph [TASK]")
+{
+    REQUIRE(EBUS_NS::test_graph() == true);
+    REQUIRE(EBUS_NS::test_wide_graph() == true);
+}
@@ -0,0 +1,75 @@
+#include "ebus/task_worker.hh"
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+class tiny_task : public EBUS_NS::task_base
+{
+public:
+    tiny_task(std::atomic<int>& counter) :
+        task_base(
+            [&counter]()
+            {
+                counter++;
+                return true;
+            })
+    {
+    }
+
+    virtual void task_done() override {}
+    virtual void add_ref() override { ++m_refcount; }
+    virtual void release() override
+    {
+        if (--m_refcount <= 0)
+            delete this;
+    }
+
+private:
+    std::atomic<int> m_refcount = 0;
+};
+
+// submit bursts of tiny tasks with a pause in between, the pattern where the
+// worker keeps falling asleep right before the next burst. Only a parked
+// worker is woken, not one per push.
+template <class worker_t>
+bool
+test_bursty(const EBUS_NS::idle_strategy& strategy)
+{
+    const int        nbursts = 50;
+    const int        nburst  = 64;
+    std::atomic<int> counter = 0;
+    worker_t         worker;
+
+    worker.set_idle_strategy(strategy);
+    std::thread worker_thread([&worker]() { worker(); });
+    for (int b = 0; b < nbursts; b++)
+    {
+        for (int i = 0; i < nburst; i++)
+        {
+            worker.add_task(EBUS_NS::task_base::ptr(new tiny_task(counter)));
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    while (counter < nbursts * nburst)
+    {
+        std::this_thread::yield();
+    }
+    worker.shutdown();
+    worker_thread.join();
+    EBUS_NS::task_worker_stats stats = worker.stats();
+
+    return counter == nbursts * nburst && stats.executed == nbursts * nburst &&
+           stats.wakeups < stats.executed;
+}
+
+TEST_CASE("test worker idle strategies [TASK_WORKER]")
+{
+    using EBUS_NS::idle_strategy;
+
+    REQUIRE(test_bursty<EBUS_NS::task_worker>(idle_strategy::park()));
+    REQUIRE(test_bursty<EBUS_NS::task_worker>(idle_strategy::spin_then_park()));
+    REQUIRE(test_bursty<EBUS_NS::lockfree_task_worker>(idle_strategy::park()));
+    REQUIRE(test_bursty<EBUS_NS::lockfree_task_worker>(idle_strategy::spin_then_park()));
+}
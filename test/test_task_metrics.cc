@@ -0,0 +1,127 @@
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace EBUS_NS
+{
+
+using namespace std::chrono_literals;
+
+bool
+test_histogram()
+{
+    task_histogram histogram;
+    for (int i = 0; i < 90; i++)
+    {
+        histogram.add(100ns);
+    }
+    for (int i = 0; i < 10; i++)
+    {
+        histogram.add(10us);
+    }
+
+    task_histogram other;
+    other.add(1ms);
+    histogram.merge(other);
+
+    // within a factor of two, rounded up.
+    auto p50 = histogram.percentile(0.5);
+    auto p95 = histogram.percentile(0.95);
+    auto max = histogram.percentile(1.0);
+    return histogram.count == 101 && p50 >= 100ns && p50 < 200ns && p95 >= 10us &&
+           p95 < 20us && max >= 1ms && max < 2ms &&
+           task_histogram().percentile(0.5) == 0ns;
+}
+
+bool
+test_snapshot()
+{
+    constexpr size_t ntasks = 200;
+
+    task_scheduler_config config;
+    config.worker_count = 2;
+    config.metrics      = true;
+    default_task_scheduler scheduler(config);
+
+    std::atomic_size_t done = 0;
+    for (size_t i = 0; i < ntasks; i++)
+    {
+        task_scheduler_iface::add_task(make_task(
+            [&done]()
+            {
+                std::this_thread::sleep_for(10us);
+                done++;
+            }));
+    }
+    task_scheduler_metrics metrics;
+    do
+    {
+        std::this_thread::yield();
+        metrics = task_metrics_iface::snapshot();
+    } while (metrics.executed() < ntasks);
+
+    return done == ntasks && metrics.workers.size() == 2 &&
+           metrics.run().count == ntasks && metrics.wait().count == ntasks &&
+           metrics.run().mean() >= 10us &&
+           metrics.busy() >= ntasks * 10us && metrics.imbalance() >= 1.0 &&
+           metrics.imbalance() <= 2.0;
+}
+
+struct metrics_listener : public ebus_handler<task_metrics_report_iface>
+{
+    metrics_listener() { connect(); }
+    ~metrics_listener() { disconnect(); }
+
+    void m_report(const task_scheduler_metrics& metrics) override
+    {
+        workers = metrics.workers.size();
+        reports++;
+    }
+
+    std::atomic_size_t workers = 0;
+    std::atomic_int    reports = 0;
+};
+
+bool
+test_reports()
+{
+    metrics_listener listener;
+
+    task_scheduler_config config;
+    config.worker_count   = 3;
+    config.metrics        = true;
+    config.metrics_period = 10ms;
+    config.virtual_clock  = true;
+    default_task_scheduler scheduler(config);
+
+    scheduler.advance_clock(5ms);
+    std::this_thread::sleep_for(1ms);
+    bool early = listener.reports == 0;
+    for (int i = 0; i < 3; i++)
+    {
+        scheduler.advance_clock(10ms);
+        while (listener.reports < i + 1)
+            std::this_thread::yield();
+    }
+    return early && listener.reports == 3 && listener.workers == 3;
+}
+
+bool
+test_disabled()
+{
+    default_task_scheduler scheduler;
+    return task_metrics_iface::snapshot().workers.empty();
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test scheduler metrics [TASK]")
+{
+    REQUIRE(EBUS_NS::test_histogram() == true);
+    REQUIRE(EBUS_NS::test_snapshot() == true);
+    REQUIRE(EBUS_NS::test_reports() == true);
+    REQUIRE(EBUS_NS::test_disabled() == true);
+}
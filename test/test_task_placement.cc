@@ -0,0 +1,208 @@
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+bool
+test_depth()
+{
+    std::atomic<int> counter = 0;
+    task_worker      worker;
+    for (int i = 0; i < 3; i++)
+    {
+        worker.add_task(make_task([&counter]() { counter++; }));
+    }
+    if (worker.depth() != 3)
+        return false;
+
+    std::thread worker_thread([&worker]() { worker(); });
+    while (counter < 3)
+        std::this_thread::yield();
+    worker.shutdown();
+    worker_thread.join();
+    return worker.depth() == 0;
+}
+
+// tiny tasks from a few submitters all run, whatever the policy.
+bool
+test_submitters(task_placement placement)
+{
+    const size_t       nsubmitters = 4;
+    const size_t       ntasks      = 20000;
+    std::atomic_size_t counter     = 0;
+
+    task_scheduler_config config;
+    config.placement = placement;
+    default_task_scheduler scheduler(config);
+
+    {
+        std::vector<std::thread> submitters;
+        for (size_t s = 0; s < nsubmitters; s++)
+        {
+            submitters.emplace_back(
+                [&counter]()
+                {
+                    for (size_t i = 0; i < ntasks; i++)
+                    {
+                        task_scheduler_iface::add_task(
+                            make_task([&counter]() { counter++; }));
+                    }
+                });
+        }
+        for (auto& submitter : submitters)
+        {
+            submitter.join();
+        }
+    }
+    while (counter < nsubmitters * ntasks)
+        std::this_thread::yield();
+    return counter == nsubmitters * ntasks;
+}
+
+// the queue depths of the workers after submit(scheduler) queued tasks, while
+// every worker is held by a task.
+template <typename submit_t>
+std::vector<size_t>
+held_depths(task_placement placement, submit_t&& submit)
+{
+    const size_t nworkers = 4;
+
+    task_scheduler_config config;
+    config.worker_count = nworkers;
+    config.placement    = placement;
+    config.connect      = false;
+    default_task_scheduler scheduler(config);
+
+    std::atomic_size_t held = 0;
+    std::atomic_bool   release = false;
+    auto               hold    = [&held, &release]()
+    {
+        held++;
+        while (!release)
+            std::this_thread::yield();
+    };
+    // a worker may get a second holder, queued until the release.
+    while (held < nworkers)
+    {
+        size_t before = held;
+        scheduler.m_add_task(make_task(hold));
+        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+        while (held == before && std::chrono::steady_clock::now() < until)
+            std::this_thread::yield();
+    }
+    submit(scheduler);
+    task_scheduler_metrics metrics = scheduler.m_snapshot();
+    release = true;
+
+    std::vector<size_t> depths;
+    for (const task_worker_metrics& worker : metrics.workers)
+    {
+        depths.push_back(worker.queue_depth);
+    }
+    return depths;
+}
+
+// the tasks of one submitter are spread evenly by the depth counters.
+bool
+test_spread(task_placement placement)
+{
+    const size_t       ntasks = 4000, bound = 16;
+    std::atomic_size_t counter = 0;
+
+    std::vector<size_t> depths = held_depths(
+        placement,
+        [&counter](default_task_scheduler& scheduler)
+        {
+            for (size_t i = 0; i < ntasks; i++)
+            {
+                scheduler.m_add_task(make_task([&counter]() { counter++; }));
+            }
+        });
+    while (counter < ntasks)
+        std::this_thread::yield();
+
+    auto [low, high] = std::minmax_element(depths.begin(), depths.end());
+    return depths.size() == 4 && *high - *low <= bound;
+}
+
+// short-lived submitters of a task each do not all start with the first
+// worker.
+bool
+test_round_robin_threads()
+{
+    const size_t       nthreads = 64;
+    std::atomic_size_t counter  = 0;
+
+    std::vector<size_t> depths = held_depths(
+        task_placement::round_robin,
+        [&counter](default_task_scheduler& scheduler)
+        {
+            for (size_t i = 0; i < nthreads; i++)
+            {
+                std::thread(
+                    [&counter, &scheduler]()
+                    { scheduler.m_add_task(make_task([&counter]() { counter++; })); })
+                    .join();
+            }
+        });
+    while (counter < nthreads)
+        std::this_thread::yield();
+
+    return *std::max_element(depths.begin(), depths.end()) <= nthreads * 3 / 4;
+}
+
+// the children of a task stay on its worker.
+bool
+test_submitter_local()
+{
+    const int        nchildren = 64;
+    std::atomic<int> done = 0, moved = 0;
+
+    task_scheduler_config config;
+    config.worker_count = 4;
+    config.placement    = task_placement::submitter_local;
+    default_task_scheduler scheduler(config);
+
+    task_scheduler_iface::add_task(make_task(
+        [&]()
+        {
+            std::thread::id parent = std::this_thread::get_id();
+            for (int i = 0; i < nchildren; i++)
+            {
+                task_scheduler_iface::add_task(make_task(
+                    [&, parent]()
+                    {
+                        if (std::this_thread::get_id() != parent)
+                            moved++;
+                        done++;
+                    }));
+            }
+        }));
+    while (done < nchildren)
+        std::this_thread::yield();
+    return moved == 0;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test task placement [TASK]")
+{
+    using EBUS_NS::task_placement;
+
+    REQUIRE(EBUS_NS::test_depth() == true);
+    REQUIRE(EBUS_NS::test_submitters(task_placement::least_loaded) == true);
+    REQUIRE(EBUS_NS::test_submitters(task_placement::power_of_two) == true);
+    REQUIRE(EBUS_NS::test_submitters(task_placement::round_robin) == true);
+    REQUIRE(EBUS_NS::test_submitters(task_placement::submitter_local) == true);
+    REQUIRE(EBUS_NS::test_spread(task_placement::least_loaded) == true);
+    REQUIRE(EBUS_NS::test_spread(task_placement::power_of_two) == true);
+    REQUIRE(EBUS_NS::test_round_robin_threads() == true);
+    REQUIRE(EBUS_NS::test_submitter_local() == true);
+}
@@ -0,0 +1,153 @@
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+// count the heap allocations of the whole program. Sanitizers bring their own
+// allocator, the count stays 0 with them.
+static std::atomic_size_t g_allocations = 0;
+
+#if defined(__SANITIZE_ADDRESS__)
+#    define TEST_SANITIZED
+#elif defined(__has_feature)
+#    if __has_feature(address_sanitizer)
+#        define TEST_SANITIZED
+#    endif
+#endif
+
+#ifndef TEST_SANITIZED
+
+void*
+operator new(size_t size)
+{
+    g_allocations++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void*
+operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void
+operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void* p, size_t) noexcept
+{
+    std::free(p);
+}
+#endif
+
+namespace EBUS_NS
+{
+
+bool
+test_block_pool()
+{
+    using pool = block_pool<48>;
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 1000; i++)
+        blocks.push_back(pool::allocate());
+    size_t reserved = pool::reserved();
+    // freed on another thread, they come back through the remote stack.
+    std::thread(
+        [&blocks]()
+        {
+            for (void* p : blocks)
+                pool::deallocate(p);
+        })
+        .join();
+    for (int i = 0; i < 1000; i++)
+        blocks[i] = pool::allocate();
+    for (void* p : blocks)
+        pool::deallocate(p);
+    return pool::reserved() == reserved;
+}
+
+bool
+test_pooled_tasks()
+{
+    const int            ntasks  = 2000;
+    std::atomic<int>     counter = 0;
+    lockfree_task_worker worker;
+    std::thread          worker_thread([&worker]() { worker(); });
+
+    int  expected = 0;
+    auto submit   = [&]()
+    {
+        for (int i = 0; i < ntasks; i++)
+        {
+            // the capture is too large for the small buffer of std::function.
+            worker.add_task(make_task([&counter, i, j = i, k = i]()
+                                      { counter += (i + j + k) >= 0; }));
+        }
+        expected += ntasks;
+        while (counter != expected)
+            std::this_thread::yield();
+    };
+
+    // warm up, then tasks are created on this thread and released on the
+    // worker without touching the heap.
+    submit();
+    size_t allocations = g_allocations;
+    submit();
+    submit();
+    bool no_allocation = g_allocations == allocations;
+
+    worker.shutdown();
+    worker_thread.join();
+    return no_allocation && counter == 3 * ntasks;
+}
+
+bool
+test_pooled_chains()
+{
+    std::atomic<int> counter = 0;
+    {
+        default_task_scheduler scheduler;
+        for (int i = 0; i < 100; i++)
+        {
+            task_scheduler_iface::add_rescheduable_task(
+                [&counter]() { return ++counter > 0; })
+                ->reschedule([&counter]() { return ++counter > 0; })
+                ->finish([&counter]() { ++counter; });
+        }
+        task_scheduler_iface::add_task(
+            make_task([&counter]() { return ++counter > 0; }));
+    }
+    return counter == 301;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test block pool [MEMORY]") { REQUIRE(EBUS_NS::test_block_pool() == true); }
+
+TEST_CASE("test pooled tasks [TASK]")
+{
+    REQUIRE(EBUS_NS::test_pooled_tasks() == true);
+    REQUIRE(EBUS_NS::test_pooled_chains() == true);
+}
@@ -0,0 +1,147 @@
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+class ordered_task final : public task_base
+{
+public:
+    ordered_task(int id, std::vector<int>& order, std::mutex& lock) :
+        task_base(
+            [id, &order, &lock]()
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                order.push_back(id);
+                return true;
+            })
+    {
+    }
+
+    virtual void task_done() override {}
+    virtual void add_ref() override { ++m_refcount; }
+    virtual void release() override
+    {
+        if (--m_refcount <= 0)
+            delete this;
+    }
+
+private:
+    std::atomic<int> m_refcount = 0;
+};
+
+struct int_lane_traits
+{
+    using key_type = int;
+
+    static constexpr size_t lanes = 3;
+    static constexpr size_t aging = 4;
+
+    // lane in the tens, key in the units
+    static size_t   lane(int v) { return v / 10; }
+    static key_type key(int v) { return v % 10; }
+};
+
+bool
+test_lanes()
+{
+    lane_container<int, int_lane_traits> lanes;
+    std::vector<int>                     order;
+
+    // background, then normal with keys out of order, then critical
+    for (int v : {20, 13, 11, 12, 1})
+        lanes.push_back(v);
+    // room made while queued leaves the items and their order.
+    lanes.reserve(16);
+    if (lanes.size() != 5)
+        return false;
+    while (!lanes.empty())
+    {
+        order.push_back(lanes.front());
+        lanes.pop_front();
+    }
+    return order == std::vector<int>{1, 11, 12, 13, 20};
+}
+
+bool
+test_aging()
+{
+    lane_container<int, int_lane_traits> lanes;
+    std::vector<int>                     order;
+
+    lanes.push_back(20);
+    for (int i = 0; i < 8; i++)
+        lanes.push_back(0);
+    while (!lanes.empty())
+    {
+        order.push_back(lanes.front());
+        lanes.pop_front();
+    }
+    // the background item is passed over 4 times then served.
+    return order[4] == 20;
+}
+
+bool
+test_priority_worker()
+{
+    std::vector<int>     order;
+    std::mutex           lock;
+    priority_task_worker worker;
+    auto                 deadline = task_clock::now();
+
+    auto add = [&](int id, task_priority priority, task_clock::time_point when)
+    {
+        task_base::ptr task(new ordered_task(id, order, lock));
+        task->m_priority = priority;
+        task->m_deadline = when;
+        worker.add_task(task);
+    };
+    // queue up before the worker starts so the order is deterministic.
+    add(4, task_priority::background, task_clock::time_point::max());
+    add(3, task_priority::normal, task_clock::time_point::max());
+    add(2, task_priority::normal, deadline + std::chrono::seconds(2));
+    add(1, task_priority::normal, deadline + std::chrono::seconds(1));
+    add(0, task_priority::critical, task_clock::time_point::max());
+
+    std::thread worker_thread([&worker]() { worker(); });
+    while (worker.size() > 0)
+    {
+        std::this_thread::yield();
+    }
+    worker.shutdown();
+    worker_thread.join();
+
+    return order == std::vector<int>{0, 1, 2, 3, 4};
+}
+
+bool
+test_tagged_add_task()
+{
+    std::vector<int> order;
+    std::mutex       lock;
+    {
+        default_task_scheduler scheduler;
+        task_scheduler_iface::add_task(task_base::ptr(new ordered_task(0, order, lock)),
+                                       task_priority::critical,
+                                       task_clock::now());
+    }
+    return order.size() == 1;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test lane container [MEMORY]")
+{
+    REQUIRE(EBUS_NS::test_lanes() == true);
+    REQUIRE(EBUS_NS::test_aging() == true);
+}
+
+TEST_CASE("test task priority [TASK]")
+{
+    REQUIRE(EBUS_NS::test_priority_worker() == true);
+    REQUIRE(EBUS_NS::test_tagged_add_task() == true);
+}
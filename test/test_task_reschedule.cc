@@ -2,9 +2,11 @@
 #include <ebus/task_scheduler.hh>
 #include <catch2/catch_test_macros.hpp>
 
+#include <atomic>
 #include <iostream>
 #include <sstream>
 #include <thread>
+#include <vector>
 
 namespace EBUS_NS
 {
@@ -55,6 +57,88 @@ test_reschedule()
     return true;
 }
 
+// the steps run in order, inline ones on the worker of the previous step.
+bool
+test_inline_steps(size_t nsteps, size_t hand_off_every)
+{
+    std::vector<std::thread::id> threads(nsteps);
+    std::vector<size_t>          order;
+    std::atomic_bool             fini = false;
+    {
+        task_scheduler_config config;
+        config.worker_count = 4;
+        default_task_scheduler scheduler(config);
+
+        auto step = [&](size_t i)
+        {
+            return [&, i]()
+            {
+                threads[i] = std::this_thread::get_id();
+                order.push_back(i);
+                return true;
+            };
+        };
+        rescheduable_task::ptr chain =
+            task_scheduler_iface::add_rescheduable_task(step(0));
+        for (size_t i = 1; i < nsteps; i++)
+        {
+            if (hand_off_every && i % hand_off_every == 0)
+                chain->hand_off(step(i));
+            else
+                chain->reschedule(step(i));
+        }
+        chain->finish([&fini]() { fini = true; });
+        while (!fini)
+            std::this_thread::yield();
+    }
+
+    for (size_t i = 0; i < nsteps; i++)
+    {
+        if (order[i] != i)
+            return false;
+        bool inlined = i > 0 && !(hand_off_every && i % hand_off_every == 0);
+        if (inlined && threads[i] != threads[i - 1])
+            return false;
+    }
+    return order.size() == nsteps;
+}
+
+// a chain written before hand_off(), only implementing reschedule().
+struct legacy_chain : public rescheduable_task
+{
+    ptr reschedule(task_base::exec_fn&& exec) override
+    {
+        m_steps.push_back(std::move(exec));
+        return ptr(this);
+    }
+    void finish(fini_fn&& fini) override { m_fini_task = std::move(fini); }
+
+    void task_done() override {}
+    void add_ref() override { m_refcount++; }
+    void release() override { m_refcount--; }
+
+    std::vector<task_base::exec_fn> m_steps;
+    int                             m_refcount = 0;
+};
+
+// hand_off() defaults to reschedule().
+bool
+test_hand_off_default()
+{
+    legacy_chain chain;
+    chain.hand_off([]() { return true; })->hand_off([]() { return true; });
+    return chain.m_steps.size() == 2 && chain.m_refcount == 0;
+}
+
 } // namespace EBUS_NS
 
 TEST_CASE("test task scheduler [TASK]") { REQUIRE(EBUS_NS::test_reschedule() == true); }
+
+TEST_CASE("test inline chain steps [TASK]")
+{
+    REQUIRE(EBUS_NS::test_inline_steps(5, 0) == true);
+    // past the steps stored in the task.
+    REQUIRE(EBUS_NS::test_inline_steps(20, 0) == true);
+    REQUIRE(EBUS_NS::test_inline_steps(20, 3) == true);
+    REQUIRE(EBUS_NS::test_hand_off_default() == true);
+}
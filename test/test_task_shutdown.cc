@@ -0,0 +1,111 @@
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace EBUS_NS
+{
+
+using namespace std::chrono_literals;
+
+class slow_task final : public task_base
+{
+public:
+    slow_task(std::atomic<int>& ran, std::atomic<int>& cancelled) :
+        task_base(
+            [&ran]()
+            {
+                std::this_thread::sleep_for(1ms);
+                ran++;
+                return true;
+            }),
+        m_cancelled(cancelled)
+    {
+    }
+
+    virtual void task_done() override {}
+    virtual void task_cancelled() override { m_cancelled++; }
+    virtual void add_ref() override { ++m_refcount; }
+    virtual void release() override
+    {
+        if (--m_refcount <= 0)
+            delete this;
+    }
+
+private:
+    std::atomic<int>& m_cancelled;
+    std::atomic<int>  m_refcount = 0;
+};
+
+constexpr int ntasks = 200;
+
+bool
+test_drain_all()
+{
+    std::atomic<int> ran = 0, cancelled = 0;
+
+    task_scheduler_config config;
+    config.worker_count = 4;
+    default_task_scheduler scheduler(config);
+    for (int i = 0; i < ntasks; i++)
+    {
+        task_scheduler_iface::add_task(task_base::ptr(new slow_task(ran, cancelled)));
+    }
+    const task_shutdown_report& report = scheduler.shutdown();
+    return ran == ntasks && cancelled == 0 && report.ran <= (size_t)ntasks &&
+           report.cancelled == 0 && report.dropped == 0 &&
+           &scheduler.shutdown() == &report;
+}
+
+bool
+test_deadline(shutdown_policy policy)
+{
+    std::atomic<int> ran = 0, cancelled = 0;
+
+    task_scheduler_config config;
+    config.worker_count = 2;
+    default_task_scheduler scheduler(config);
+    for (int i = 0; i < ntasks; i++)
+    {
+        task_scheduler_iface::add_task(task_base::ptr(new slow_task(ran, cancelled)));
+    }
+
+    task_shutdown_options options;
+    options.timeout                    = 10ms;
+    options.policy                     = policy;
+    const task_shutdown_report& report = scheduler.shutdown(options);
+
+    size_t discarded = report.cancelled + report.dropped;
+    bool   notified  = policy == shutdown_policy::cancel
+                           ? report.cancelled == (size_t)cancelled && report.dropped == 0
+                           : report.dropped > 0 && cancelled == 0;
+    return notified && discarded > 0 && ran + discarded == (size_t)ntasks &&
+           report.discarded[(size_t)task_priority::normal] == discarded &&
+           report.took < 1s;
+}
+
+bool
+test_timers_dropped()
+{
+    std::atomic<int> ran = 0;
+    {
+        default_task_scheduler scheduler;
+        task_scheduler_iface::add_task_after(1h, make_task([&ran]() { ran++; }));
+        task_scheduler_iface::add_task_after(1h, make_task([&ran]() { ran++; }));
+        if (scheduler.shutdown().timers != 2)
+            return false;
+    }
+    return ran == 0;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test scheduler shutdown [TASK]")
+{
+    REQUIRE(EBUS_NS::test_drain_all() == true);
+    REQUIRE(EBUS_NS::test_deadline(EBUS_NS::shutdown_policy::cancel) == true);
+    REQUIRE(EBUS_NS::test_deadline(EBUS_NS::shutdown_policy::drop) == true);
+    REQUIRE(EBUS_NS::test_timers_dropped() == true);
+}
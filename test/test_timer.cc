@@ -0,0 +1,176 @@
+#include <ebus/task_scheduler.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace EBUS_NS
+{
+
+bool
+test_wheel()
+{
+    timer_wheel<int>                        wheel;
+    std::vector<uint64_t>                   expiries;
+    std::vector<timer_wheel<int>::timer_id> ids;
+    std::mt19937_64                         rng(42);
+
+    // near and far timers, a few past the top wheel.
+    for (int i = 0; i < 10000; i++)
+    {
+        uint64_t expiry = rng() % (i % 100 == 0 ? (1ull << 38) : 100000);
+        expiries.push_back(expiry);
+        ids.push_back(wheel.add(expiry, i));
+    }
+    // cancel every 10th.
+    for (int i = 0; i < 10000; i += 10)
+    {
+        if (!wheel.cancel(ids[i]))
+            return false;
+    }
+    if (wheel.cancel(ids[0]) || wheel.size() != 9000)
+        return false;
+
+    uint64_t prev_expiry = 0;
+    bool     ordered     = true;
+    for (uint64_t to = 0; wheel.size() > 0; to += 1 + rng() % (1ull << 30))
+    {
+        wheel.advance(to,
+                      [&](int i)
+                      {
+                          ordered &= expiries[i] >= prev_expiry && expiries[i] <= to;
+                          prev_expiry = expiries[i];
+                      });
+        // nothing left behind.
+        if (wheel.size() > 0 && wheel.next_expiry() <= to)
+            return false;
+    }
+    return ordered;
+}
+
+bool
+test_wheel_periodic()
+{
+    timer_wheel<int> wheel(1000);
+    int              fired = 0;
+    auto             id    = wheel.add(1005, 7, 10);
+
+    wheel.advance(1004, [&](int) { fired++; });
+    if (fired != 0)
+        return false;
+    wheel.advance(1005, [&](int) { fired++; });
+    wheel.advance(1015, [&](int) { fired++; });
+    if (fired != 2)
+        return false;
+    // a late advance fires once and skips the missed periods.
+    wheel.advance(1100, [&](int) { fired++; });
+    if (fired != 3 || wheel.next_expiry() != 1105)
+        return false;
+    return wheel.cancel(id) && wheel.size() == 0;
+}
+
+bool
+test_virtual_clock()
+{
+    using std::chrono::milliseconds;
+
+    std::atomic<int> once = 0, periodic = 0;
+    {
+        task_scheduler_config config;
+        config.virtual_clock = true;
+        default_task_scheduler scheduler(config);
+
+        task_scheduler_iface::add_task_after(milliseconds(10),
+                                             make_task([&]() { once++; }));
+        auto id = task_scheduler_iface::add_periodic_task(
+            milliseconds(4), make_task([&]() { periodic++; }));
+
+        auto settle = [&](int expect_once, int expect_periodic)
+        {
+            // the due tasks are on the workers.
+            for (int i = 0; i < 1000; i++)
+            {
+                if (once == expect_once && periodic == expect_periodic)
+                    break;
+                std::this_thread::sleep_for(milliseconds(1));
+            }
+            return once == expect_once && periodic == expect_periodic;
+        };
+
+        scheduler.advance_clock(milliseconds(3));
+        if (!settle(0, 0))
+            return false;
+        scheduler.advance_clock(milliseconds(3)); // 6ms
+        if (!settle(0, 1))
+            return false;
+        scheduler.advance_clock(milliseconds(4)); // 10ms
+        if (!settle(1, 2))
+            return false;
+        if (!task_scheduler_iface::cancel_timer(id))
+            return false;
+        scheduler.advance_clock(milliseconds(100));
+        if (!settle(1, 2))
+            return false;
+    }
+    return true;
+}
+
+bool
+test_real_clock()
+{
+    std::atomic<int>       fired = 0;
+    task_clock::time_point start = task_clock::now(), at;
+    {
+        default_task_scheduler scheduler;
+        task_scheduler_iface::add_task_after(std::chrono::milliseconds(20),
+                                             make_task(
+                                                 [&]()
+                                                 {
+                                                     at = task_clock::now();
+                                                     fired++;
+                                                 }));
+        while (fired == 0)
+            std::this_thread::yield();
+    }
+    return at - start >= std::chrono::milliseconds(20);
+}
+
+// a scheduler written before the timers still builds, without timers.
+struct inline_scheduler : public ebus_handler<task_scheduler_iface>
+{
+    inline_scheduler() { connect(); }
+
+    void m_add_task(task_base::ptr task) override { task->run(); }
+    rescheduable_task::ptr m_add_rescheduable_task(const task_base::exec_fn&) override
+    {
+        return nullptr;
+    }
+};
+
+bool
+test_no_timers()
+{
+    inline_scheduler scheduler;
+    int              ran = 0;
+    task_scheduler_iface::add_task(make_task([&ran]() { ran++; }));
+    auto id = task_scheduler_iface::add_task_after(std::chrono::milliseconds(1),
+                                                   make_task([&ran]() { ran++; }));
+    return ran == 1 && id == 0 && !task_scheduler_iface::cancel_timer(1);
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test timer wheel [MEMORY]")
+{
+    REQUIRE(EBUS_NS::test_wheel() == true);
+    REQUIRE(EBUS_NS::test_wheel_periodic() == true);
+}
+
+TEST_CASE("test delayed tasks [TASK]")
+{
+    REQUIRE(EBUS_NS::test_virtual_clock() == true);
+    REQUIRE(EBUS_NS::test_real_clock() == true);
+    REQUIRE(EBUS_NS::test_no_timers() == true);
+}
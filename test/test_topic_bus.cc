@@ -0,0 +1,199 @@
+#include <ebus/topic_bus.hh>
+
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace EBUS_NS
+{
+
+struct packet_iface
+{
+    virtual void packet(const topic& t, uint32_t bytes) = 0;
+    virtual void reset()                                 = 0;
+};
+
+using packet_bus = topic_bus<packet_iface>;
+
+struct packet_counter : public topic_handler<packet_iface>
+{
+    explicit packet_counter(std::initializer_list<std::string_view> patterns)
+    {
+        for (std::string_view pattern : patterns)
+        {
+            subscribe(pattern);
+        }
+    }
+
+    void packet(const topic& t, uint32_t bytes) override
+    {
+        m_packets++;
+        m_bytes += bytes;
+        m_last   = std::string(t.name);
+    }
+    void reset() override { m_resets++; }
+
+    using topic_handler<packet_iface>::subscribe;
+    using topic_handler<packet_iface>::unsubscribe;
+
+    int         m_packets = 0;
+    int         m_resets  = 0;
+    uint32_t    m_bytes   = 0;
+    std::string m_last;
+};
+
+// literals hash at compile time, the same as fnv1a at runtime.
+static_assert(topic("net.eth0.rx").id == fnv1a("net.eth0.rx"));
+
+bool
+test_match()
+{
+    return topic_index::match("net.*.rx", "net.eth0.rx") &&
+           !topic_index::match("net.*.rx", "net.eth0.tx") &&
+           !topic_index::match("net.*.rx", "net.rx") &&
+           !topic_index::match("net.*", "net.eth0.rx") &&
+           topic_index::match("net.**", "net.eth0.rx") &&
+           topic_index::match("net.**", "net") &&
+           topic_index::match("**", "anything.at.all") &&
+           topic_index::match("net.eth0", "net.eth0") &&
+           !topic_index::match("net.eth0", "net.eth0.rx");
+}
+
+// wildcards resolve on either side: topics interned before a subscription
+// and after it.
+bool
+test_wildcards()
+{
+    packet_bus::publish("net.eth0.rx", &packet_iface::packet, 1u); // interned first
+
+    packet_counter rx({"net.*.rx"}), all({"net.**"}), exact({"disk.sda.rx"});
+    packet_counter eth0({"net.eth0.*", "net.eth0.rx"});
+
+    packet_bus::publish("net.eth0.rx", &packet_iface::packet, 100u);
+    packet_bus::publish("net.wlan0.rx", &packet_iface::packet, 10u);
+    packet_bus::publish("net.eth0.tx", &packet_iface::packet, 1000u);
+    packet_bus::publish("net", &packet_iface::reset);
+
+    // subscribed with two matching patterns, called once.
+    bool counted = rx.m_packets == 2 && rx.m_bytes == 110 && eth0.m_packets == 2 &&
+                   eth0.m_bytes == 1100 && all.m_packets == 3 && all.m_resets == 1 &&
+                   exact.m_packets == 0 && rx.m_last == "net.wlan0.rx";
+
+    rx.unsubscribe();
+    packet_bus::publish("net.eth0.rx", &packet_iface::packet, 1u);
+    return counted && rx.m_packets == 2 && eth0.m_packets == 3 && all.m_packets == 4;
+}
+
+// a name known at runtime is interned once, then published by id.
+bool
+test_intern()
+{
+    packet_counter counter({"plugin.*.event"});
+
+    std::string name = "plugin.";
+    name += "audio.event";
+    topic interned = packet_bus::intern(name);
+    name.clear();
+
+    size_t topics = packet_bus::index().topics();
+    for (int i = 0; i < 10; i++)
+    {
+        packet_bus::publish(interned, &packet_iface::packet, 2u);
+    }
+    return counter.m_packets == 10 && counter.m_last == "plugin.audio.event" &&
+           interned.id == topic("plugin.audio.event").id &&
+           packet_bus::index().topics() == topics;
+}
+
+// destroyed handlers leave the lists.
+bool
+test_destroyed()
+{
+    {
+        packet_counter scoped({"gone.*"});
+        packet_bus::publish("gone.soon", &packet_iface::reset);
+        if (scoped.m_resets != 1)
+            return false;
+    }
+    return packet_bus::index().subscribers(topic("gone.soon"))->empty();
+}
+
+struct one_shot : public topic_handler<packet_iface>
+{
+    one_shot() { subscribe("once.*"); }
+
+    void packet(const topic&, uint32_t) override
+    {
+        m_packets++;
+        unsubscribe();
+    }
+    void reset() override {}
+
+    int m_packets = 0;
+};
+
+// handlers unsubscribing while called, the others are still called.
+bool
+test_unsubscribe_in_publish()
+{
+    one_shot first, second, third;
+    packet_bus::publish("once.now", &packet_iface::packet, 1u);
+    bool all = first.m_packets == 1 && second.m_packets == 1 && third.m_packets == 1;
+    packet_bus::publish("once.now", &packet_iface::packet, 1u);
+    return all && first.m_packets == 1 && second.m_packets == 1 && third.m_packets == 1;
+}
+
+// a "**" before the last segment is refused, nothing subscribed.
+bool
+test_bad_pattern()
+{
+    packet_counter counter({});
+    if (counter.subscribe("bad.**.rx") || counter.subscribe("**.rx"))
+        return false;
+    packet_bus::publish("bad.eth0.rx", &packet_iface::packet, 1u);
+    packet_bus::publish("bad.rx", &packet_iface::packet, 1u);
+    if (counter.m_packets != 0 || !counter.subscribe("bad.**"))
+        return false;
+    packet_bus::publish("bad.eth0.rx", &packet_iface::packet, 1u);
+    return counter.m_packets == 1;
+}
+
+// a thread interns new topics publishing while another subscribes.
+bool
+test_threads()
+{
+    packet_counter    stable({"load.stable"}), churn({});
+    std::atomic<bool> done = false;
+    std::thread       publisher(
+        [&done]()
+        {
+            for (int i = 0; i < 2000; i++)
+            {
+                packet_bus::publish("load.stable", &packet_iface::packet, 1u);
+                std::string name = "load.new." + std::to_string(i);
+                packet_bus::publish(topic(name), &packet_iface::packet, 1u);
+            }
+            done = true;
+        });
+    while (!done)
+    {
+        churn.subscribe("load.**");
+        churn.unsubscribe();
+    }
+    publisher.join();
+    return stable.m_packets == 2000 && stable.m_bytes == 2000;
+}
+
+} // namespace EBUS_NS
+
+TEST_CASE("test topic bus [TOPIC]")
+{
+    REQUIRE(EBUS_NS::test_match() == true);
+    REQUIRE(EBUS_NS::test_wildcards() == true);
+    REQUIRE(EBUS_NS::test_intern() == true);
+    REQUIRE(EBUS_NS::test_destroyed() == true);
+    REQUIRE(EBUS_NS::test_unsubscribe_in_publish() == true);
+    REQUIRE(EBUS_NS::test_bad_pattern() == true);
+    REQUIRE(EBUS_NS::test_threads() == true);
+}